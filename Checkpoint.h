@@ -0,0 +1,84 @@
+#pragma once
+
+
+// Render Checkpoint ======================================
+// Records the progress of a render so that later sessions
+// can resume it, appending more photons to the same file.
+// The block holds the photons emitted so far, the state of
+// the seed generator, and the state of every RNG stream
+// of every thread. A session records a checkpoint as soon
+// as it starts, holding the streams it is about to draw
+// from and the photon indices it claims, then again every
+// so often and when it ends. Resumed streams jump ahead of
+// their recorded state, far past anything drawn from it,
+// and additional streams are seeded beyond all previous
+// ones, so no session ever repeats another's random
+// sequence, even after one is killed. Quasi-random samplers
+// instead continue their sequences past the photon indices
+// claimed by the last session, with the same scramble seed.
+
+
+struct Checkpoint : vector<Random> {
+	struct CheckpointHeader : BlockHeader {
+		uint64	Photons   = 0;		// Photons emitted by all sessions.
+		uint64	Sequence  = 0;		// First photon index of the next session.
+		Random	Seed;				// Seed generator after seeding every stream.
+		uint32	Threads   = 0;		// Number of RNG stream states that follow.
+		uint32	Scramble  = 0;		// Scramble seed of quasi-random samples, for every session.
+
+		CheckpointHeader(const uint32 Threads = 0) :
+			BlockHeader(TAG_Checkpoint, sizeof CheckpointHeader + sizeof Random * Threads),
+			Threads(Threads) {}
+
+		inline bool Validate() const {
+			return BlockHeader::Validate(TAG_Checkpoint,
+				sizeof CheckpointHeader + sizeof Random * Threads);
+		}
+	} Header;
+
+	// Write the checkpoint block at the current stream position, or at
+	// the tail of the file while blocks are appended concurrently.
+	// Returns true on error.
+	bool Write(DataStream& Stream) {
+		assert(size() < (1ULL << 16));
+
+		// Size the header to the thread states that follow.
+		auto hdr = Header;
+		hdr.Size    = uint32(sizeof CheckpointHeader + sizeof Random * size());
+		hdr.Threads = uint32(size());
+
+		if (Stream.Appending()) {
+			// Reserve the block, and write the states before the header, as film blocks are.
+			DataStream::AsyncIO io;
+			uint64 offset;
+			return Stream.Reserve(hdr, offset, io) ||
+				Stream.BeginWriteAt(offset + sizeof hdr, data(), size(), io) || Stream.Complete(io) ||
+				Stream.BeginWriteAt(offset, &hdr, 1, io) || Stream.Complete(io);
+		}
+
+		auto sync = Stream.Sync();
+		return Stream.WriteHeader(hdr) || Stream.Write(data(), size());
+	}
+
+	// Read the last checkpoint block in the stream.
+	// Returns true if no valid checkpoint was found.
+	bool ReadLast(DataStream& Stream) {
+		auto sync = Stream.Sync();
+		if (Stream.Rewind())
+			return true;
+
+		// Read each checkpoint in turn. The last one wins.
+		bool found = false;
+		for (CheckpointHeader hdr; !Stream.Seek(TAG_Checkpoint) && !Stream.ReadHeader(hdr);) {
+			vector<Random> states(hdr.Threads);
+			if (Stream.Read(states.data(), states.size()))
+				break;
+
+			Header = hdr;
+			assign(states.begin(), states.end());
+			found = true;
+		}
+
+		return !found;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,279 @@
+#pragma once
+
+
+// Hit Record Compression =================================
+// Packs blocks of hit records for storage, losslessly. The
+// order of records within a block carries no meaning, so
+// they are sorted by lens position first, and the sorted
+// positions are delta coded. Records are then shuffled into
+// byte planes, one per byte of a record, and each plane is
+// entropy coded on its own with rANS over the frequencies
+// of its bytes. Planes that would not shrink are stored.
+
+
+// Order-0 rANS Byte Coder
+// Asymmetric numeral systems (Duda, 2013), renormalized a byte
+// at a time, after "rans_byte" by Fabian Giesen. Symbols are
+// encoded in reverse, so they are decoded in order.
+struct ByteCoder {
+	static constexpr uint32 ScaleBits = 12;				// Frequencies sum to 2^ScaleBits.
+	static constexpr uint32 Scale     = 1u << ScaleBits;
+	static constexpr uint32 Lower     = 1u << 23;		// Lower bound of the normalized state.
+
+	using CountTable = array<uint32, 256>;
+	using FreqTable  = array<uint16, 256>;
+
+	// Scale the counts of each byte to frequencies summing to Scale.
+	// Every byte present keeps a nonzero frequency.
+	static FreqTable Normalize(const CountTable& Counts, const uint32 Total) {
+		assert(Total);
+
+		FreqTable freqs{};
+		uint32 sum = 0, largest = 0;
+		for (uint32 sym = 0; sym < 256; sym++) {
+			if (!Counts[sym])
+				continue;
+
+			freqs[sym] = uint16(max(uint64(Counts[sym]) * Scale / Total, 1ull));
+			sum += freqs[sym];
+			if (freqs[sym] > freqs[largest])
+				largest = sym;
+		}
+
+		// Correct the rounding with the most frequent bytes.
+		if (sum < Scale)
+			freqs[largest] += uint16(Scale - sum);
+		for (; sum > Scale; sum--)
+			(*max_element(freqs.begin(), freqs.end()))--;
+
+		return freqs;
+	}
+
+	// Estimate the encoded size of bytes with the supplied counts, in bytes.
+	static float64 Estimate(const CountTable& Counts, const uint32 Total) {
+		float64 bits = 0;
+		for (const auto count : Counts)
+			if (count)
+				bits += count * log2(float64(Total) / count);
+		return bits / 8;
+	}
+
+	// Encode a sequence of bytes, writing backwards from End.
+	// Returns the number of bytes written.
+	static size_t Encode(const uint8* Bytes, const uint32 Count, const FreqTable& Freqs, uint8* End) {
+		array<uint32, 256> starts;
+		exclusive_scan(Freqs.begin(), Freqs.end(), starts.begin(), 0u);
+
+		// Two states alternate between the bytes, sharing one stream.
+		auto* out = End;
+		uint32 states[2] = {Lower, Lower};
+		for (auto index = Count; index--;) {
+			const auto sym  = Bytes[index];
+			const auto freq = uint32(Freqs[sym]);
+			auto& state = states[index & 1];
+
+			// Renormalize, so the state stays in range once the symbol is encoded.
+			const auto limit = ((Lower >> ScaleBits) << 8) * freq;
+			for (; state >= limit; state >>= 8)
+				*--out = uint8(state);
+
+			state = ((state / freq) << ScaleBits) + (state % freq) + starts[sym];
+		}
+
+		// Flush the final states.
+		out -= sizeof states;
+		memcpy(out, states, sizeof states);
+		return size_t(End - out);
+	}
+
+	// Decode a sequence of bytes, storing each Stride bytes apart.
+	// Returns true on error.
+	static bool Decode(const uint8* Data, const uint8* const End, const FreqTable& Freqs,
+		uint8* Bytes, const size_t Stride, const uint32 Count) {
+		// Map each slot of the scale to its symbol, frequency less one, and start.
+		array<uint32, Scale> slots;
+		uint32 start = 0;
+		for (uint32 sym = 0; sym < 256; sym++) {
+			const uint32 freq = Freqs[sym];
+			if (start + freq > Scale)
+				return true;
+
+			fill_n(&slots[start], freq, sym | (freq - 1) << 8 | start << 20);
+			start += freq;
+		}
+
+		uint32 states[2];
+		if (start != Scale || End - Data < ptrdiff_t(sizeof states))
+			return true;
+
+		memcpy(states, Data, sizeof states);
+		Data += sizeof states;
+
+		// Decode a byte with a state, then renormalize it.
+		const auto step = [&](uint32& State, const uint32 Index) {
+			const auto slot  = slots[State & (Scale - 1)];
+			const auto freq  = ((slot >> 8) & (Scale - 1)) + 1;
+			Bytes[Index * Stride] = uint8(slot);
+
+			State = freq * (State >> ScaleBits) + (State & (Scale - 1)) - (slot >> 20);
+			for (; State < Lower; State = (State << 8) | *Data++)
+				if (Data == End)
+					return true;
+			return false;
+		};
+
+		uint32 index = 0;
+		for (; index + 1 < Count; index += 2)
+			if (step(states[0], index) || step(states[1], index + 1))
+				return true;
+
+		return index < Count && step(states[0], index);
+	}
+};
+
+// Hit Record Codec
+// Keeps the scratch buffers of packing between blocks.
+template <typename HitType>
+struct HitCodec {
+	using CoordType = decltype(declval<HitType>().Pos.v);
+	static_assert(sizeof CoordType == 2 && is_trivially_copyable_v<HitType>);
+
+	static constexpr uint32 Planes = sizeof HitType;	// Byte planes per record.
+
+	// Byte Plane Header
+	struct PlaneHeader {
+		uint32	Coded;		// Is the plane entropy coded, or stored?
+		uint32	Bytes;		// Bytes of data following the header, and table if coded.
+	};
+
+	vector<HitType>	_Sorted;	// Records sorted by position.
+	vector<HitType>	_Swap;		// Records in the midst of sorting.
+	vector<uint8>	_Plane;		// One plane of bytes.
+	vector<uint8>	_Coded;		// The plane, encoded.
+
+	// Pack a sequence of hit records, replacing the contents of Output.
+	void Pack(const HitType* const Hits, const uint32 Count, vector<uint8>& Output) {
+		Sort(Hits, Count);
+
+		// Delta code the sorted positions.
+		auto* hits = (uint8*)_Sorted.data();
+		uint16 prev = 0;
+		for (uint32 index = 0; index < Count; index++) {
+			auto& v = _Sorted[index].Pos.v;
+			const auto value = bit_cast<uint16>(v);
+			v = bit_cast<CoordType>(uint16(value - prev));
+			prev = value;
+		}
+
+		// Encode each byte plane, unless it would not shrink.
+		Output.resize(0);
+		_Plane.resize(Count);
+		_Coded.resize(Count * 2 + 16);
+		for (uint32 plane = 0; plane < Planes; plane++) {
+			ByteCoder::CountTable counts{};
+			for (uint32 index = 0; index < Count; index++) {
+				const auto byte = hits[index * Planes + plane];
+				_Plane[index] = byte;
+				counts[byte]++;
+			}
+
+			constexpr auto TableBytes = sizeof ByteCoder::FreqTable;
+			const auto estimate = Count ? ByteCoder::Estimate(counts, Count) + TableBytes : Infinity;
+			if (estimate < Count * 0.95) {
+				const auto freqs = ByteCoder::Normalize(counts, Count);
+				const auto bytes = ByteCoder::Encode(_Plane.data(), Count, freqs, _Coded.data() + _Coded.size());
+				if (bytes + TableBytes < Count) {
+					Append(Output, PlaneHeader{1, uint32(TableBytes + bytes)});
+					Append(Output, freqs);
+					Output.insert(Output.end(), _Coded.end() - bytes, _Coded.end());
+					continue;
+				}
+			}
+
+			Append(Output, PlaneHeader{0, Count});
+			Output.insert(Output.end(), _Plane.begin(), _Plane.end());
+		}
+	}
+
+	// Unpack a sequence of hit records.
+	// Returns true on error.
+	bool Unpack(const uint8* Data, const size_t Bytes, HitType* const Hits, const uint32 Count) {
+		const auto* const end = Data + Bytes;
+		auto* const hits = (uint8*)Hits;
+
+		// Decode each byte plane into place.
+		for (uint32 plane = 0; plane < Planes; plane++) {
+			PlaneHeader hdr;
+			if (end - Data < ptrdiff_t(sizeof hdr))
+				return true;
+
+			memcpy(&hdr, Data, sizeof hdr);
+			Data += sizeof hdr;
+			if (uint64(end - Data) < hdr.Bytes)
+				return true;
+
+			const auto* const next = Data + hdr.Bytes;
+			if (hdr.Coded) {
+				ByteCoder::FreqTable freqs;
+				if (hdr.Bytes < sizeof freqs)
+					return true;
+
+				memcpy(&freqs, Data, sizeof freqs);
+				if (ByteCoder::Decode(Data + sizeof freqs, next, freqs, hits + plane, Planes, Count))
+					return true;
+			} else {
+				if (hdr.Bytes != Count)
+					return true;
+
+				for (uint32 index = 0; index < Count; index++)
+					hits[index * Planes + plane] = Data[index];
+			}
+
+			Data = next;
+		}
+
+		// Restore the positions from their deltas.
+		uint16 prev = 0;
+		for (uint32 index = 0; index < Count; index++) {
+			auto& v = Hits[index].Pos.v;
+			prev += bit_cast<uint16>(v);
+			v = bit_cast<CoordType>(prev);
+		}
+
+		return Data != end;
+	}
+
+protected:
+	// Sort the records into _Sorted by position, v then u (LSD radix sort).
+	void Sort(const HitType* const Hits, const uint32 Count) {
+		_Sorted.resize(Count);
+		_Swap.resize(Count);
+
+		const auto key = [](const HitType& Hit) {
+			return uint32(bit_cast<uint16>(Hit.Pos.v)) << 16 | bit_cast<uint16>(Hit.Pos.u);
+		};
+
+		// Four passes of a byte each, from Hits and back and forth, ending in _Sorted.
+		const HitType* from = Hits;
+		for (uint32 pass = 0; pass < 4; pass++) {
+			auto* to = (pass & 1) ? _Sorted.data() : _Swap.data();
+			const auto shift = pass * 8;
+
+			array<uint32, 257> offsets{};
+			for (uint32 index = 0; index < Count; index++)
+				offsets[((key(from[index]) >> shift) & 0xFF) + 1]++;
+			partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			for (uint32 index = 0; index < Count; index++)
+				to[offsets[(key(from[index]) >> shift) & 0xFF]++] = from[index];
+			from = to;
+		}
+	}
+
+	// Append the bytes of an object to the output.
+	template <typename ObjectType>
+	static void Append(vector<uint8>& Output, const ObjectType& Object) {
+		const auto* bytes = (const uint8*)&Object;
+		Output.insert(Output.end(), bytes, bytes + sizeof Object);
+	}
+};
\ No newline at end of file
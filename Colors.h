@@ -11,27 +11,50 @@ struct RGBSystem {
 	using MaterialType = RColor;
 	using StorageType  = BColor;
 
-	// Stop tracing if the photon dims substantially.
-	static constexpr auto LumaCutoff = 0.001r;
-
 	// Use the emitter to select an emissive color to emit.
 	inline static void Emit(EmissiveType& Color, const EmitterType& Emitter) {
 		Color = Emitter;
 	}
 
-	// Diminish the emissive color on material interactions.
-	inline static bool Absorb(EmissiveType& Color, const MaterialType& Material) {
-		return (Color *= Material).Sum() < LumaCutoff;
+	// Diminish the emissive color on material interactions, then play
+	// Russian roulette: the photon survives with a probability given by
+	// its remaining throughput, and survivors are brightened to match.
+	// Random is uniform in [0..1). Returns true if the photon is absorbed.
+	inline static bool Absorb(EmissiveType& Color, const MaterialType& Material, const Real Random) {
+		Color *= Material;
+
+		const auto survival = Survival(Color);
+		if (Random >= survival)
+			return true;
+
+		Color /= survival;
+		return false;
+	}
+
+	// Return the probability that a photon of this color survives.
+	// Survivors are compensated to full brightness in their strongest channel.
+	inline static Real Survival(const EmissiveType& Color) {
+		return min(Color.Max(), 1r);
 	}
 
 	// Convert the emissive color to its storage format.
+	// Colors are stored as RGBE, with a shared exponent in alpha,
+	// since weighted photons may be far brighter or dimmer than 1.
 	inline static StorageType Store(const EmissiveType& Color) {
-		return {(Color * 255r).Clamp4(0r, 255r), 0};
+		int exp;
+		frexp(Color.Max(), &exp);
+		if (!(Color.Max() > 0r) || exp < -127)
+			return {0, 0, 0, 0};
+
+		exp = min(exp, 127);
+		return {(Color * ldexp(256r, -exp) + 0.5r).Clamp4(0r, 255r), uint8(exp + 128)};
 	}
 
 	// Restore a stored emissive color.
+	// A zero exponent marks a linear 8-bit color, as stored by older files.
 	inline static EmissiveType Load(const StorageType& Color) {
-		return EmissiveType(Color) / 255r;
+		const auto rgb = EmissiveType(Color.x, Color.y, Color.z, 0);
+		return Color.w ? rgb * ldexp(1r, int(Color.w) - 136) : rgb / 255r;
 	}
 };
 
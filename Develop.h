@@ -0,0 +1,437 @@
+#pragma once
+
+
+// Photon Development =====================================
+// Projects captured photons through the virtual lens onto
+// images, a batch of hit records at a time. What does not
+// depend on the focus of a frame is computed once for the
+// batch in SIMD lanes: records are gathered and decoded to
+// each photon's position, direction, and color, and then
+// its lens deflection and projected direction are found.
+// Photons masked by the aperture are then dropped. Each
+// frame projects the batch to pixel indices in lanes, and
+// colors are accumulated a photon at a time, so photons
+// landing on the same pixel never conflict.
+
+
+// Decoded Photons
+// Views of hit records decoded into structure-of-arrays form.
+// Each array is padded to a multiple of the widest SIMD lanes.
+struct DecodedPhotons {
+	const Real*	PosX;	const Real* PosY;						// Positions on the lens.
+	const Real*	DirX;	const Real* DirY;	const Real* DirZ;	// Directions.
+	const Real*	Red;	const Real* Green;	const Real* Blue;	// Colors.
+};
+
+// A Batch of Photons to Develop (Structure of Arrays)
+// Capacity must be a multiple of the widest SIMD lanes.
+template <uint32 Capacity = 1024>
+struct DevelopBatch {
+	static_assert(Capacity % 16 == 0);
+
+	static constexpr uint32 Size = Capacity;			// Most records loaded at once.
+
+	using RealArray = array<Real, Capacity>;
+
+	alignas(CacheLine) RealArray PosX, PosY;			// Positions on the virtual lens.
+	alignas(CacheLine) RealArray DirX, DirY, DirZ;		// Decoded ray directions.
+	alignas(CacheLine) RealArray ProjX, ProjY, ProjZ;	// Projected ray directions.
+	alignas(CacheLine) RealArray Red, Green, Blue;		// Decoded colors.
+	alignas(CacheLine) RealArray Open;					// Is the photon within the aperture (1 or 0)?
+	alignas(CacheLine) RealArray Pixel;					// Pixel index in the current frame, or -1.
+	alignas(CacheLine) array<RColor, Capacity> Color;	// Colors of the photons within the aperture.
+
+	uint32	Count = 0;									// Photons within the aperture.
+
+	// Decode up to Capacity hit records, scaling positions to a lens of the supplied radius.
+	template <typename HitType>
+	void Decode(const HitType* Hits, const uint32 Records, const Real Radius) {
+		static_assert(is_same_v<decltype(Hits->Pos.u), Fixed16> && is_same_v<typename HitType::System, RGBSystem>);
+		assert(Records <= Capacity);
+
+		// Whole lanes first, then the records left over one at a time.
+		uint32 index = 0;
+		if (CPU.AVX512)
+			index = DecodeLanes<Real16>(Hits, index, Records, Radius);
+		else if (CPU.AVX2)
+			index = DecodeLanes<Real8>(Hits, index, Records, Radius);
+		DecodeLanes<Real>(Hits, index, Records, Radius);
+	}
+
+	// Return views of the decoded records.
+	[[nodiscard]] DecodedPhotons Decoded() const {
+		return {PosX.data(), PosY.data(), DirX.data(), DirY.data(), DirZ.data(),
+			Red.data(), Green.data(), Blue.data()};
+	}
+
+	// Load up to Capacity hit records, projecting them through a virtual
+	// lens of the supplied radius and focal length. Photons arriving at a
+	// cosine to the lens deflection below Limit are masked by the aperture.
+	// The brightness of every record is added to Brightness.
+	template <typename HitType>
+	void Load(const HitType* Hits, const uint32 Records, const Real Radius, const Real FocalLen,
+		const Real Limit, float64& Brightness) {
+		Decode(Hits, Records, Radius);
+		Load(Decoded(), Records, FocalLen, Limit, Brightness);
+	}
+
+	// Load up to Capacity decoded records, which may be the batch's own.
+	void Load(const DecodedPhotons& Photons, const uint32 Records, const Real FocalLen,
+		const Real Limit, float64& Brightness) {
+		assert(Records <= Capacity);
+
+		if (CPU.AVX512)
+			LensLanes<Real16>(Photons, Records, FocalLen, Limit);
+		else if (CPU.AVX2)
+			LensLanes<Real8>(Photons, Records, FocalLen, Limit);
+		else
+			LensLanes<Real>(Photons, Records, FocalLen, Limit);
+
+		// Keep the photons within the aperture.
+		Count = 0;
+		for (uint32 index = 0; index < Records; index++) {
+			const RColor color(Photons.Red[index], Photons.Green[index], Photons.Blue[index], 0);
+			Brightness += color.Max();
+			if (!Open[index])
+				continue;
+
+			PosX [Count] = Photons.PosX[index];
+			PosY [Count] = Photons.PosY[index];
+			ProjX[Count] = ProjX[index];
+			ProjY[Count] = ProjY[index];
+			ProjZ[Count] = ProjZ[index];
+			Color[Count] = color;
+			Count++;
+		}
+	}
+
+	// Project the photons onto the image plane at a distance behind
+	// the lens, then scale and center them to accumulate on the image.
+	void Expose(RImage& Image, const Real Distance, const RVector& Scale, const RVector& Center) {
+		if (CPU.AVX512)
+			ProjectLanes<Real16>(Image.Dimensions, Distance, Scale, Center);
+		else if (CPU.AVX2)
+			ProjectLanes<Real8>(Image.Dimensions, Distance, Scale, Center);
+		else
+			ProjectLanes<Real>(Image.Dimensions, Distance, Scale, Center);
+
+		for (uint32 index = 0; index < Count; index++)
+			if (Pixel[index] >= 0r)
+				Image[size_t(Pixel[index])] += Color[index];
+	}
+
+protected:
+	// Decode hit records from Begin towards End, a whole lane at a time.
+	// Returns the index of the first record not decoded.
+	template <typename LaneType, typename HitType>
+	uint32 DecodeLanes(const HitType* Hits, uint32 Begin, const uint32 End, const Real Radius) {
+		using L = Lanes<LaneType>;
+
+		for (; Begin + L::Width <= End; Begin += L::Width) {
+			const auto& hit = Hits[Begin];
+			const auto pos = L::Gather(&hit.Pos, sizeof HitType);
+			const auto dir = L::Gather(&hit.Dir, sizeof HitType);
+			const auto clr = L::Gather(&hit.Clr, sizeof HitType);
+
+			// Decode the photon's hit position and direction.
+			const auto dirX = ToReal(Low16 (dir)) / 32768r;
+			const auto dirY = ToReal(High16(dir)) / 32768r;
+			Store(&PosX[Begin], ToReal(Low16 (pos)) / 32768r * Radius);
+			Store(&PosY[Begin], ToReal(High16(pos)) / 32768r * Radius);
+			Store(&DirX[Begin], dirX);
+			Store(&DirY[Begin], dirY);
+			Store(&DirZ[Begin], Sqrt(1r - dirX*dirX - dirY*dirY));
+
+			// Decode the photon color, as RGBSystem::Load.
+			// Colors are stored blue first, with the exponent last.
+			const auto exponent = ToReal(Byte(clr, 3));
+			const auto shared   = exponent > 0r;
+			const auto scale    = Exp2(exponent - 136r);
+			const auto red   = ToReal(Byte(clr, 2));
+			const auto green = ToReal(Byte(clr, 1));
+			const auto blue  = ToReal(Byte(clr, 0));
+			Store(&Red  [Begin], Select(shared, red   * scale, red   / 255r));
+			Store(&Green[Begin], Select(shared, green * scale, green / 255r));
+			Store(&Blue [Begin], Select(shared, blue  * scale, blue  / 255r));
+		}
+
+		return Begin;
+	}
+
+	// Find the lens deflection, aperture mask, and projected direction of decoded records.
+	template <typename LaneType>
+	void LensLanes(const DecodedPhotons& Photons, const uint32 Records, const Real FocalLen, const Real Limit) {
+		using L = Lanes<LaneType>;
+
+		for (uint32 index = 0; index < Records; index += L::Width) {
+			const auto posX = L::LoadUnaligned(&Photons.PosX[index]);
+			const auto posY = L::LoadUnaligned(&Photons.PosY[index]);
+			const auto dirX = L::LoadUnaligned(&Photons.DirX[index]);
+			const auto dirY = L::LoadUnaligned(&Photons.DirY[index]);
+			auto dirZ = L::LoadUnaligned(&Photons.DirZ[index]);
+
+			// Compute deflection at this location on the virtual lens.
+			const auto defLen = Sqrt(posX*posX + posY*posY + FocalLen*FocalLen);
+			const auto defX = posX / defLen;
+			const auto defY = posY / defLen;
+			const auto defZ = FocalLen / defLen;
+
+			// Eliminate photons masked by the aperture.
+			const auto masked = dirX*defX + dirY*defY + dirZ*defZ < Limit;
+			Store(&Open[index], Select(masked, LaneType(0r), LaneType(1r)));
+
+			// Add the virtual lens surface normal to the ray direction,
+			// and compute the projected ray's new direction.
+			dirZ = 1r - dirZ;
+			const auto projX = dirX - defX;
+			const auto projY = dirY - defY;
+			const auto projZ = dirZ - defZ;
+			const auto projLen = Sqrt(projX*projX + projY*projY + projZ*projZ);
+			Store(&ProjX[index], projX / projLen);
+			Store(&ProjY[index], projY / projLen);
+			Store(&ProjZ[index], projZ / projLen);
+		}
+	}
+
+	// Find the pixel index of each photon on an image of the supplied
+	// dimensions, or -1 for photons falling outside of it. Indices are
+	// exact for images of up to 2^24 pixels.
+	template <typename LaneType>
+	void ProjectLanes(const Coord& Dimensions, const Real Distance, const RVector& Scale, const RVector& Center) {
+		using L = Lanes<LaneType>;
+
+		const LaneType width (Real(Dimensions.x));
+		const LaneType height(Real(Dimensions.y));
+		for (uint32 index = 0; index < Count; index += L::Width) {
+			// Compute where the projected ray intersects the image plane.
+			const auto projZ = L::Load(&ProjZ[index]);
+			const auto imgX  = L::Load(&PosX[index]) - L::Load(&ProjX[index]) * Distance / projZ;
+			const auto imgY  = L::Load(&PosY[index]) - L::Load(&ProjY[index]) * Distance / projZ;
+
+			// Normalize and center the image.
+			const auto x = imgX * Scale.x + Center.x;
+			const auto y = imgY * Scale.y + Center.y;
+
+			// Check the bounds, which also rejects NaN and infinite positions.
+			const auto inside = (x >= 0r) & (y >= 0r) & (x < width) & (y < height);
+			Store(&Pixel[index], Select(inside, Trunc(y) * width + Trunc(x), LaneType(-1r)));
+		}
+	}
+};
+
+
+// Develop hit records a photon at a time, without SIMD lanes.
+// The reference for DevelopBatch, which must match its frames.
+template <typename HitType>
+void DevelopScalar(const span<const HitType> Hits, vector<RImage>& Images, const vector<Real>& Distances,
+	const Real Radius, const Real FocalLen, const Real Limit, const RVector& Scale, const RVector& Center,
+	float64& Brightness) {
+	// Process each captured photon.
+	for (const auto& hit : Hits) {
+		// Decode the photon color.
+		const auto color = RGBSystem::Load(hit.Clr);
+		Brightness += color.Max();
+
+		// Decode the photon's hit position.
+		// Relative to the virtual lens position.
+		RVector recPos{hit.Pos.u, hit.Pos.v};
+		recPos *= Radius;
+
+		// Decode the photon's direction.
+		// Relative to the virtual lens direction.
+		RVector recDir{hit.Dir.u, hit.Dir.v};
+		recDir.z = sqrt(1r - recDir.x*recDir.x - recDir.y*recDir.y);
+
+		// Compute deflection at this location on the virtual lens.
+		const auto lensDef = RVector{recPos.x, recPos.y, FocalLen}.Normalized();
+
+		// Eliminate photons masked by the aperture.
+		if (recDir.Dot(lensDef) < Limit)
+			continue;
+
+		// Add the virtual lens surface normal to the ray direction.
+		recDir.z = 1r - recDir.z;
+
+		// Compute the projected ray's new direction.
+		const RVector projDir = (recDir - lensDef).Normalized();
+
+		// Project the photon onto the image of each frame.
+		for (size_t index = 0; index < Images.size(); index++) {
+			// Compute where the projected ray intersects the image plane.
+			const auto imgPos = recPos + projDir * Distances[index] / -projDir.z;
+
+			// Normalize and center the image.
+			const auto pixel = imgPos * Scale + Center;
+
+			// Perform lower boundary checks.
+			if (pixel.x < 0r || pixel.y < 0r ||
+				isnan(pixel.x) || isinf(pixel.x) ||
+				isnan(pixel.y) || isinf(pixel.y))
+				continue;
+
+			// Convert to pixel coordinates.
+			// Perform upper boundary checks.
+			auto& image = Images[index];
+			const Coord coord{pixel.x, pixel.y};
+			if (coord.x >= image.Dimensions.x ||
+				coord.y >= image.Dimensions.y)
+				continue;
+
+			// Accumulate color on this pixel.
+			image(coord) += color;
+		}
+	}
+}
+
+
+// Decoded Photon Cache ===================================
+// A sidecar to a data stream file, holding its photons as
+// DevelopBatch decodes them. None of the decoded values
+// depend on the virtual camera, so once the cache is built
+// it is mapped, and its photons are projected in place on
+// every run without decoding. The cache records the size
+// and last write time of its source, and is rebuilt when
+// either changes.
+
+
+struct PhotonCache {
+	static constexpr uint32 Arrays = 8;		// Arrays of each block, as in DecodedPhotons.
+
+	// Source Header
+	// Identifies the file the cache was decoded from.
+	struct SourceHeader : BlockHeader {
+		uint64	Size = 0;		// Size of the source file in bytes.
+		int64	Time = 0;		// Last write time of the source file.
+
+		SourceHeader() :
+			BlockHeader(TAG_Source, sizeof SourceHeader) {}
+
+		[[nodiscard]] inline bool Validate() const {
+			return BlockHeader::Validate(TAG_Source, sizeof SourceHeader);
+		}
+	};
+
+	// Decoded Photons Header
+	// Followed by the arrays of DecodedPhotons, each of Stride Reals.
+	struct DecodedHeader : BlockHeader {
+		uint32	Count;
+
+		DecodedHeader(const uint32 Count = 0) :
+			BlockHeader(TAG_Decoded, Bytes(Count)),
+			Count(Count) {}
+
+		// Return the length of each array, padded to the widest SIMD lanes.
+		[[nodiscard]] static constexpr uint32 Stride(const uint32 Count) {
+			return (Count + 15) & ~15u;
+		}
+
+		[[nodiscard]] static constexpr size_t Bytes(const uint32 Count) {
+			return sizeof DecodedHeader + sizeof Real * Arrays * Stride(Count);
+		}
+
+		[[nodiscard]] inline bool Validate() const {
+			return BlockHeader::Validate(TAG_Decoded, uint32(Bytes(Count)));
+		}
+
+		// Return views of the arrays following the header.
+		[[nodiscard]] DecodedPhotons Photons() const {
+			const auto* arrays = (const Real*)(this + 1);
+			const auto  stride = Stride(Count);
+			return {arrays, arrays + stride, arrays + stride * 2, arrays + stride * 3, arrays + stride * 4,
+				arrays + stride * 5, arrays + stride * 6, arrays + stride * 7};
+		}
+	};
+
+	MappedStream	Map;	// View of the cache file.
+
+	// Open the cache of a data stream file, with the photons scaled to a lens
+	// of the supplied radius. The cache is built first if missing or stale.
+	// Returns true on error.
+	template <typename HitType>
+	bool Open(const path& Source, const MappedStream& Data, const Real Radius) {
+		const auto cache = path(Source) += ".cache";
+
+		error_code error;
+		SourceHeader source;
+		source.Size = file_size(Source, error);
+		if (!error)
+			source.Time = last_write_time(Source, error).time_since_epoch().count();
+		if (error)
+			return true;
+
+		if (!Map.Open(cache) && !Stale(source))
+			return false;
+
+		Map.Close();
+		return Build<HitType>(cache, source, Data, Radius) || Map.Open(cache) || Stale(source);
+	}
+
+	// Return the entries of the cache's blocks of decoded photons.
+	[[nodiscard]] vector<IndexEntry> Blocks() const {
+		return Map.Blocks({TAG_Decoded});
+	}
+
+	// Call the supplied function with the decoded photons of each of the listed
+	// blocks, and their number, such as a partition of the cache's blocks.
+	template <typename LambdaFunc>
+	void Read(const span<const IndexEntry> Blocks, LambdaFunc Func) const {
+		uint64 prefetched = 0;
+		for (const auto& entry : Blocks) {
+			const auto* hdr = (const DecodedHeader*)Map.At(entry.Offset);
+			if (!hdr || hdr->Validate())
+				return;
+
+			// Keep the pages ahead of the reader on their way in.
+			if (entry.Offset >= prefetched) {
+				Map.Prefetch(entry.Offset, MappedStream::Window);
+				prefetched = entry.Offset + MappedStream::Window / 2;
+			}
+
+			Func(hdr->Photons(), hdr->Count);
+		}
+	}
+
+protected:
+	// Is the mapped cache missing its source header, or built from another source?
+	[[nodiscard]] bool Stale(const SourceHeader& Source) const {
+		uint64 cursor = Map.Begin();
+		const auto* hdr = (const SourceHeader*)Map.Next(cursor, {TAG_Source});
+		return !hdr || hdr->Validate() || hdr->Size != Source.Size || hdr->Time != Source.Time;
+	}
+
+	// Decode the photons of the source into a new cache file. It is written
+	// under a temporary name and then renamed, so a partial cache is never used.
+	// Returns true on error.
+	template <typename HitType>
+	static bool Build(const path& Cache, const SourceHeader& Source, const MappedStream& Data, const Real Radius) {
+		const auto partial = path(Cache) += ".tmp";
+		const auto batch   = make_unique<DevelopBatch<>>();
+
+		DataStream stream;
+		if (stream.New(partial))
+			return true;
+
+		ColorFilm<HitType> film;
+		auto failed = stream.WriteHeader(Source);
+		film.ReadHits(Data, [&](auto& hits) {
+			for (size_t offset = 0; offset < hits.size() && !failed; offset += batch->Size) {
+				const auto records = uint32(min(hits.size() - offset, size_t(batch->Size)));
+				const auto stride  = DecodedHeader::Stride(records);
+				batch->Decode(&hits[offset], records, Radius);
+
+				failed = stream.WriteHeader(DecodedHeader(records)) ||
+					stream.Write(batch->PosX.data(),  stride) || stream.Write(batch->PosY.data(),  stride) ||
+					stream.Write(batch->DirX.data(),  stride) || stream.Write(batch->DirY.data(),  stride) ||
+					stream.Write(batch->DirZ.data(),  stride) || stream.Write(batch->Red.data(),   stride) ||
+					stream.Write(batch->Green.data(), stride) || stream.Write(batch->Blue.data(),  stride);
+			}
+		});
+
+		failed = stream.Close() || failed;
+
+		error_code error;
+		if (!failed)
+			rename(partial, Cache, error);
+		return failed || error;
+	}
+};
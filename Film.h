@@ -27,6 +27,7 @@ struct Fixed16 {
 // Photon Hit Record (Compact Storage Format)
 template <typename CoordType, typename ColorSystem>
 struct HitRecord {
+	using System    = ColorSystem;
 	using ColorType = ColorSystem::EmissiveType;
 
 	struct { CoordType u, v; } Pos;	// Hit Position
@@ -40,12 +41,112 @@ struct HitRecord {
 		Pos{CoordType(UPos), CoordType(VPos)}, Dir{CoordType(UDir), CoordType(VDir)}, Clr(ColorSystem::Store(Color)) {}
 };
 
+// Low-Resolution Film Preview
+// Accumulates a coarse image of captured photons binned by
+// direction, which is how a lens focused at infinity would
+// image them. Per-bin sums of luminance and its square give
+// a cheap estimate of the noise in the developed image.
+struct FilmPreview {
+	static constexpr uint32 Size = 32;	// Width and height, in bins.
+
+	using BinsType = array<float64, Size * Size>;
+
+	mutex		_Lock;					// Guards the bins.
+	BinsType	_Sum{};					// Sum of luminance per bin.
+	BinsType	_SumSq{};				// Sum of squared luminance per bin.
+
+	// Bin a sequence of captured photons.
+	template <typename HitType>
+	void Expose(const HitType* Hits, const size_t Count) {
+		auto sync = lock_guard<mutex>(_Lock);
+
+		for (size_t hit = 0; hit < Count; hit++) {
+			const auto& rec = Hits[hit];
+			const auto luma = Luma(rec);
+			const auto bin  = Bin(rec);
+
+			_Sum  [bin] += luma;
+			_SumSq[bin] += luma * luma;
+		}
+	}
+
+	// Return the bin of a captured photon, by its direction.
+	template <typename HitType>
+	[[nodiscard]] static inline uint32 Bin(const HitType& Hit) {
+		const auto u = min(uint32((Real(Hit.Dir.u) + 1r) * (Size / 2)), Size - 1);
+		const auto v = min(uint32((Real(Hit.Dir.v) + 1r) * (Size / 2)), Size - 1);
+		return v * Size + u;
+	}
+
+	// Return the luminance of a captured photon.
+	template <typename HitType>
+	[[nodiscard]] static inline float64 Luma(const HitType& Hit) {
+		return float64(HitType::System::Load(Hit.Clr).Sum());
+	}
+
+	// Estimate the relative noise per pixel of an image with the supplied
+	// number of pixels, developed from the photons of all previews.
+	// Returns infinity if no photons have been captured.
+	static float64 Noise(vector<FilmPreview>& Previews, const uint64 Pixels) {
+		BinsType sum{}, sumSq{};
+		for (auto& preview : Previews) {
+			auto sync = lock_guard<mutex>(preview._Lock);
+			for (uint32 bin = 0; bin < Size * Size; bin++) {
+				sum  [bin] += preview._Sum  [bin];
+				sumSq[bin] += preview._SumSq[bin];
+			}
+		}
+
+		// The relative error of a bin is sqrt(SumSq) / Sum. Weighting each bin
+		// by its energy keeps dark, empty bins from dominating the estimate.
+		float64 energy = 0, error = 0;
+		for (uint32 bin = 0; bin < Size * Size; bin++) {
+			energy += sum[bin];
+			error  += sqrt(sumSq[bin]);
+		}
+
+		// A pixel receives 1/Scale of a bin's photons, so its relative
+		// error is larger by a factor of sqrt(Scale).
+		const auto scale = float64(Pixels) / (Size * Size);
+		return energy > 0 ? error / energy * sqrt(scale) : Infinity;
+	}
+};
+
+// Binned Film
+// Bins captured photons in memory, as a preview does, instead
+// of storing them. Measures convergence without any file I/O.
+template <typename HitType>
+struct BinnedFilm {
+	FilmPreview::BinsType	Bins{};			// Sum of luminance per bin.
+	uint64					_Exposures = 0;	// Statistics: Exposures recorded.
+
+	// Expose the digital film to the photon.
+	// Returns true on error.
+	inline bool Expose(HitType&& Hit) {
+		Bins[FilmPreview::Bin(Hit)] += FilmPreview::Luma(Hit);
+		_Exposures++;
+		return false;
+	}
+};
+
 enum BlockTags {
-	TAG_Config	= 1,	// Camera Configuration
-	TAG_Hits	= 2,	// Photon Hit Records
+	TAG_Config		= 1,	// Camera Configuration
+	TAG_Hits		= 2,	// Photon Hit Records
+	TAG_Checkpoint	= 3,	// Render Checkpoint
+	TAG_Mesh		= 4,	// Triangle Mesh
+	TAG_Packed		= 5,	// Compressed Photon Hit Records
+	TAG_Source		= 6,	// Source of a Decoded Photon Cache
+	TAG_Decoded		= 7,	// Decoded Photons
 };
 
 // Simple Digital Film
+// Double-buffered: while one buffer is exposed to photons,
+// the other is written in flight. The header of a block is
+// written as soon as its records land, so that readers and
+// resumed renders see the block complete without waiting
+// for the next buffer to fill. Films are read from mapped
+// streams. Blocks may be written compressed, and either kind
+// is read transparently.
 template <typename HitType>
 struct ColorFilm : vector<HitType> {
 	// Virtual Camera Configuration
@@ -75,14 +176,49 @@ struct ColorFilm : vector<HitType> {
 		}
 	};
 
-	DataStream* Stream = nullptr;	// Pointer to the data streamer.
-	uint64		_Exposures = 0;		// Statistics: Exposures recorded.
+	// Compressed Photon Hit Record Storage
+	// The header of a plain block under its own tag, sized by the packed records.
+	struct PackedHeader : FilmHeader {
+		PackedHeader(const uint32 Count = 0, const size_t Bytes = 0) : FilmHeader(Count) {
+			this->Ident = TAG_Packed;
+			this->Size  = uint32(sizeof PackedHeader + Bytes);
+		}
+
+		inline bool Validate() const {
+			return BlockHeader::Validate() || this->Ident != TAG_Packed || this->Size < sizeof PackedHeader;
+		}
+	};
+
+	DataStream*  Stream = nullptr;	// Pointer to the data streamer.
+	FilmPreview* Preview = nullptr;	// Optional preview of flushed photons.
+	atomic_uint64_t* Flushed = nullptr;	// Optional count of photons whose blocks have been headed.
+	bool		 Packed = false;	// Write compressed blocks.
+	uint64		 _Exposures = 0;	// Statistics: Exposures recorded.
+
+	vector<HitType>		 _Spare;	// Buffer in flight.
+	vector<uint8>		 _Packed;	// Compressed records in flight.
+	FilmHeader			 _Header;	// Header of the block in flight.
+	uint64				 _Offset = 0;	// File offset of the block in flight.
+	uint64				 _Traced = 0;	// Photons traced, with every hit in the buffer or before.
+	uint64				 _Pending = 0;	// Photons traced, with every hit in the block in flight or before.
+	bool				 _Payload = false;	// Are the records of the block in flight, ahead of its header?
+	DataStream::AsyncIO	 _IO;		// Transfer of the block in flight.
+	HitCodec<HitType>	 _Codec;	// Compression scratch buffers.
 
 	ColorFilm() = default;
 
 	ColorFilm(DataStream* Stream, const size_t BufferLimit) : Stream(Stream) {
 		assert(Stream && BufferLimit && BufferLimit < (1ULL << 32));
 		this->reserve(BufferLimit);
+		_Spare.reserve(BufferLimit);
+	}
+
+	ColorFilm& operator = (ColorFilm&&) = default;
+
+	~ColorFilm() {
+		// Leave no transfer in flight into a released buffer.
+		if (Stream)
+			Stream->Complete(_IO);
 	}
 
 	// Expose the digital film to the photon.
@@ -91,54 +227,105 @@ struct ColorFilm : vector<HitType> {
 		// Encode and buffer the captured photon.
 		this->push_back(forward<HitType>(Hit));
 
-		// Flush the buffer when full.
+		// Head the block in flight once its records have landed.
+		if (_Payload && DataStream::Done(_IO) && Head())
+			return true;
+
+		// Submit the buffer when full.
 		assert(this->size() < (1ULL << 32));
-		return this->size() != this->capacity() || Flush();
+		return this->size() != this->capacity() || Submit();
 	}
 
-	// Write all buffered photons to the data stream.
+	// Note photons traced to completion, every hit of which has been exposed.
+	inline void Traced(const uint64 Photons) {
+		_Traced += Photons;
+	}
+
+	// Count the photons of the block in flight as flushed, once its header is written.
+	inline void Headed() {
+		if (Flushed)
+			*Flushed += exchange(_Pending, 0);
+	}
+
+	// Write all buffered photons to the data stream, and wait for them.
 	// Returns true on error.
-	bool Flush() {
+	inline bool Flush() {
+		return Submit() || Complete();
+	}
+
+	// Begin writing all buffered photons to the data stream, then
+	// carry on exposing the spare buffer while they are in flight.
+	// Returns true on error.
+	bool Submit() {
 		assert(Stream && this->size() < (1ULL << 32));
-		const auto hits = uint32(this->size());
+
+		// Wait for the previous block, then trade buffers with it.
+		if (Complete())
+			return true;
+
+		this->swap(_Spare);
+		const auto hits = uint32(_Spare.size());
 		_Exposures += hits;
+		_Pending = exchange(_Traced, 0);
+
+		// Update the preview, if any.
+		if (Preview)
+			Preview->Expose(_Spare.data(), hits);
+
+		// Compress the records, if asked, and prepare the block header.
+		const uint8* payload = (const uint8*)_Spare.data();
+		if (Packed) {
+			_Codec.Pack(_Spare.data(), hits, _Packed);
+			_Header = PackedHeader(hits, _Packed.size());
+			payload = _Packed.data();
+		} else
+			_Header = FilmHeader(hits);
+
+		const auto bytes = _Header.Size - sizeof _Header;
+
+		if (Stream->Appending()) {
+			// Reserve the block at the tail of the file, and write its records there
+			// without the lock. The header follows once the records are complete.
+			if (Stream->Reserve(_Header, _Offset, _IO) ||
+				Stream->BeginWriteAt(_Offset + sizeof _Header, payload, bytes, _IO))
+				return true;
+
+			_Payload = true;
+			return false;
+		}
 
-		// Prepare the block header.
-		const FilmHeader hdr(hits);
-		
 		// Obtain ownership of the data stream.
 		auto sync = Stream->Sync();
 
 		// Write the hit record block.
-		if (Stream->WriteHeader(hdr) ||
-			Stream->Write(this->data(), hits))
+		if (Stream->WriteHeader(_Header) || Stream->Write(payload, bytes))
 			return true;
 
-		// Empty the buffer.
-		this->resize(0);
-
+		Headed();
 		return false;
 	}
 
-	// Read a block of hit records.
+	// Begin writing the header of the block in flight, once its records are complete.
 	// Returns true on error.
-	bool Read() {
-		assert(Stream);
+	bool Head() {
+		_Payload = false;
+		if (Stream->Complete(_IO) || Stream->BeginWriteAt(_Offset, &_Header, 1, _IO))
+			return true;
 
-		// Obtain ownership of the data stream.
-		auto sync = Stream->Sync();
+		Headed();
+		return false;
+	}
 
-		// Seek to the next block of hit records.
-		FilmHeader hdr;
-		if (Stream->Seek(TAG_Hits) ||
-			Stream->ReadHeader(hdr))
+	// Complete the block in flight, if any, heading it if that has not begun.
+	// Returns true on error.
+	bool Complete() {
+		if ((_Payload && Head()) || Stream->Complete(_IO))
 			return true;
 
-		// Prepare the hit record buffer.
-		this->resize(hdr.Count);
+		// Empty the spare buffer.
+		_Spare.resize(0);
 
-		// Read the hit records.
-		return Stream->Read(this->data(), hdr.Count);
+		return false;
 	}
 
 	// Write the virtual camera configuration.
@@ -149,17 +336,62 @@ struct ColorFilm : vector<HitType> {
 		return Stream->WriteHeader(Config);
 	}
 
-	// Read the virtual camera configuration.
+	// Read the virtual camera configuration from a mapped stream.
 	// Returns true on error.
-	inline bool ReadConfig() {
-		assert(Stream);
-		auto sync = Stream->Sync();
-		return Stream->Seek(TAG_Config) || Stream->ReadHeader(Config);
+	bool ReadConfig(const MappedStream& Map) {
+		auto cursor = Map.Begin();
+		const auto* hdr = (const ConfigHeader*)Map.Next(cursor, {TAG_Config});
+		if (!hdr || hdr->Validate())
+			return true;
+
+		Config = *hdr;
+		return false;
 	}
 
-	// Call the supplied function on each block of hit records.
+	// Call the supplied function on a span of each block of hit records in a
+	// mapped stream. Plain records are visited in place, while packed (or
+	// misaligned) records are unpacked into the film's buffer.
 	template <typename LambdaFunc>
-	inline void ReadHits(LambdaFunc Func) {
-		for (; !Read(); Func(*this));
+	inline void ReadHits(const MappedStream& Map, LambdaFunc Func) {
+		ReadHits(Map, Map.Blocks({TAG_Hits, TAG_Packed}), Func);
+	}
+
+	// Call the supplied function on a span of each of the listed blocks of
+	// hit records in a mapped stream, such as a partition of its blocks.
+	template <typename LambdaFunc>
+	void ReadHits(const MappedStream& Map, const span<const IndexEntry> Blocks, LambdaFunc Func) {
+		uint64 prefetched = 0;
+		for (const auto& entry : Blocks) {
+			const auto* block = Map.At(entry.Offset);
+			if (!block)
+				return;
+
+			// Keep the pages ahead of the reader on their way in.
+			if (entry.Offset >= prefetched) {
+				Map.Prefetch(entry.Offset, MappedStream::Window);
+				prefetched = entry.Offset + MappedStream::Window / 2;
+			}
+
+			const auto& hdr = *(const FilmHeader*)block;
+			const auto* records = (const uint8*)block + sizeof hdr;
+
+			span<const HitType> hits;
+			if (hdr.Ident == TAG_Packed) {
+				this->resize(hdr.Count);
+				if (((const PackedHeader&)hdr).Validate() ||
+					_Codec.Unpack(records, hdr.Size - sizeof hdr, this->data(), hdr.Count))
+					return;
+				hits = *this;
+			} else if (hdr.Validate())
+				return;
+			else if (uintptr_t(records) % alignof(HitType)) {
+				this->resize(hdr.Count);
+				memcpy(this->data(), records, sizeof HitType * hdr.Count);
+				hits = *this;
+			} else
+				hits = {(const HitType*)records, hdr.Count};
+
+			Func(hits);
+		}
 	}
 };
\ No newline at end of file
@@ -53,9 +53,29 @@ struct ImageType : vector<Type> {
 };
 
 
-// Image Template with Targa Output
+// Image File Formats
+enum class ImageFormat {
+	Targa,		// 24/32bit Targa, clamped to [0..255].
+	Pfm,		// Portable float map of linear RGB.
+	Exr,		// OpenEXR scanlines of linear 32bit float RGB, uncompressed.
+	ExrRle,		// OpenEXR scanlines as above, run-length encoded.
+};
+
+// Return the file name extension of an image format.
+[[nodiscard]] constexpr string_view Extension(const ImageFormat Format) {
+	return Format == ImageFormat::Targa ? "tga" : Format == ImageFormat::Pfm ? "pfm" : "exr";
+}
+
+
+// Image Template with File Output
+// Images are encoded into a contiguous buffer and written in one call.
+// Every format is oriented as the image is seen through the lens, which
+// mirrors it: Targa and PFM rows are stored bottom to top, and OpenEXR
+// rows top to bottom, each right to left. Multi-byte values are stored
+// in the byte order of the host, which all of these formats expect
+// to be little endian.
 template <typename PixelType>
-class TargaType : public ImageType<PixelType> {
+class ImageFile : public ImageType<PixelType> {
 protected:
 #pragma pack(push, 1)
 	// Targa File Header
@@ -68,54 +88,301 @@ protected:
 		uint16	Width, Height;
 		uint8	BPP, ImgDesc;
 	};
+
+	// OpenEXR Channel List Entry
+	struct EXRChannel {
+		char	Name[2];			// Single letter, null terminated.
+		int32	Type      = 2;		// 32bit float
+		uint8	Linear    = 0;
+		uint8	Reserved[3]{};
+		int32	XSampling = 1;
+		int32	YSampling = 1;
+	};
 #pragma pack(pop)
 
+	static constexpr uint32 EXRMagic = 20000630;
+	static constexpr uint32 EXRVersion = 2;		// Single part of scanlines.
+
 public:
 	using ImageType<PixelType>::ImageType;
 
-	// Write the image as a 24 or 32bit Targa file.
+	// Return the pixels of a row.
+	[[nodiscard]] inline const PixelType* Row(const Integer y) const {
+		return this->data() + size_t(y) * this->Dimensions.x;
+	}
+
+	// Encode the image in a file format, replacing the contents of Output.
+	// Targa files hold 24 or 32bit pixels.
+	template <int Channels = 3>
+	void Encode(vector<uint8>& Output, const ImageFormat Format = ImageFormat::Targa) const {
+		Output.clear();
+		if (Format == ImageFormat::Targa)
+			EncodeTarga<Channels>(Output);
+		else if (Format == ImageFormat::Pfm)
+			EncodePfm(Output);
+		else
+			EncodeExr(Output, Format == ImageFormat::ExrRle);
+	}
+
+	// Write the image to a file, as a 24 or 32bit Targa file by default.
 	// Returns true on error.
 	template <int Channels = 3>
-	bool Write(const string& Filename) {
-		// Open the output file for writing.
+	bool Write(const string& Filename, const ImageFormat Format = ImageFormat::Targa) const {
+		vector<uint8> bytes;
+		Encode<Channels>(bytes, Format);
+		return Save(Filename, bytes);
+	}
+
+	// Write an encoded image to a file, in a single call.
+	// Returns true on error.
+	static bool Save(const string& Filename, const vector<uint8>& Bytes) {
 		ofstream file(Filename, ios::binary | ios::trunc);
 		if (!file.is_open())
 			return true;
 
-		// Write the Targa header.
+		file.write((const char*)Bytes.data(), streamsize(Bytes.size()));
+		file.close();
+		return file.fail();
+	}
+
+protected:
+	// Encode a Targa file of clamped 8bit channels.
+	template <int Channels>
+	void EncodeTarga(vector<uint8>& Output) const {
+		const auto [width, height] = this->Dimensions;
+
 		TGAHeader header{};
-		header.Width  = this->Dimensions.x;
-		header.Height = this->Dimensions.y;
+		header.Width  = uint16(width);
+		header.Height = uint16(height);
 		header.BPP    = Channels * 8;
-		file.write((const char*)&header, sizeof TGAHeader);
-		if (file.bad())
-			return true;
+		Append(Output, header);
 
-		// Write pixels.
-		this->ForEach(
-			[&](const Coord& Coord) {
-				const auto color = (*this)(Coord).Color();
-				file.write((const char*)&color, Channels);
-			});
+		Output.resize(sizeof header + size_t(width) * height * Channels);
+		auto* out = Output.data() + sizeof header;
+		for (auto y = height; y--;)
+			for (auto* pixel = Row(y) + width; pixel-- != Row(y); out += Channels) {
+				const auto color = pixel->Color();
+				memcpy(out, &color, Channels);
+			}
+	}
 
-		// Close the file. Done!
-		file.close();
-		return false;
+	// Encode a portable float map, its negative scale marking little endian.
+	void EncodePfm(vector<uint8>& Output) const {
+		const auto [width, height] = this->Dimensions;
+
+		const auto header = format("PF\n{} {}\n-1.0\n", width, height);
+		Output.assign(header.begin(), header.end());
+
+		Output.resize(header.size() + size_t(width) * height * 3 * sizeof float32);
+		auto* out = Output.data() + header.size();
+		for (auto y = height; y--;)
+			for (auto* pixel = Row(y) + width; pixel-- != Row(y); out += 3 * sizeof float32) {
+				const float32 color[3] = {float32(pixel->Red()), float32(pixel->Green()), float32(pixel->Blue())};
+				memcpy(out, color, sizeof color);
+			}
+	}
+
+	// Encode an OpenEXR file, after the subset of its layout written by the
+	// reference library for one part of scanlines, uncompressed or RLE: a
+	// block per line, holding all of the line's blue, then green, then red.
+	void EncodeExr(vector<uint8>& Output, const bool Rle) const {
+		const auto [width, height] = this->Dimensions;
+
+		// Append an attribute of the header, its value made of several objects.
+		const auto attribute = [&](const string_view Name, const string_view Type, const auto&... Values) {
+			AppendText(Output, Name);
+			AppendText(Output, Type);
+			Append(Output, int32((sizeof Values + ...)));
+			(Append(Output, Values), ...);
+		};
+
+		const array<int32, 4> window{0, 0, width - 1, height - 1};
+		Append(Output, EXRMagic);
+		Append(Output, EXRVersion);
+		attribute("channels", "chlist", EXRChannel{"B"}, EXRChannel{"G"}, EXRChannel{"R"}, uint8(0));
+		attribute("compression", "compression", uint8(Rle));
+		attribute("dataWindow", "box2i", window);
+		attribute("displayWindow", "box2i", window);
+		attribute("lineOrder", "lineOrder", uint8(0));
+		attribute("pixelAspectRatio", "float", float32(1));
+		attribute("screenWindowCenter", "v2f", array<float32, 2>{0, 0});
+		attribute("screenWindowWidth", "float", float32(1));
+		Append(Output, uint8(0));
+
+		// The table of block offsets is filled in as the blocks are appended.
+		const auto table = Output.size();
+		Output.resize(table + sizeof uint64 * height);
+
+		vector<uint8> line(size_t(width) * 3 * sizeof float32), packed;
+		for (Integer y = 0; y < height; y++) {
+			// Pixels hold blue, green and red in that order too.
+			auto* out = (float32*)line.data();
+			for (size_t channel = 0; channel < 3; channel++)
+				for (auto* pixel = Row(y) + width; pixel-- != Row(y);)
+					*out++ = float32((*pixel)[channel]);
+
+			// Blocks that would not shrink are stored.
+			const auto& data = Rle && PackRle(line, packed) < line.size() ? packed : line;
+
+			const auto offset = uint64(Output.size());
+			memcpy(Output.data() + table + sizeof offset * y, &offset, sizeof offset);
+			Append(Output, int32(y));
+			Append(Output, int32(data.size()));
+			Output.insert(Output.end(), data.begin(), data.end());
+		}
+	}
+
+	// Run-length encode a block as OpenEXR does. Bytes are split into even
+	// and odd halves and delta coded, then runs of 3 to 128 repeats are coded
+	// as a count less one and the byte, and other spans as their negated length
+	// and bytes. Returns the encoded size.
+	static size_t PackRle(const vector<uint8>& Data, vector<uint8>& Output) {
+		constexpr ptrdiff_t MinRun = 3, MaxRun = 127;
+
+		const auto size = Data.size();
+		vector<uint8> split(size);
+		for (size_t index = 0; index < size; index++)
+			split[(index & 1) ? (size + 1) / 2 + index / 2 : index / 2] = Data[index];
+		for (size_t index = size; --index > 0;)
+			split[index] = uint8(split[index] - split[index - 1] + 128);
+
+		Output.clear();
+		const auto* const end = split.data() + size;
+		for (const auto* run = split.data(); run < end;) {
+			const auto* next = run + 1;
+			while (next < end && *next == *run && next - run - 1 < MaxRun)
+				next++;
+
+			if (next - run >= MinRun) {
+				Output.push_back(uint8(next - run - 1));
+				Output.push_back(*run);
+			} else {
+				// Extend the span up to the next run of at least three.
+				while (next < end && next - run < MaxRun &&
+					(next + 2 >= end || next[0] != next[1] || next[1] != next[2]))
+					next++;
+
+				Output.push_back(uint8(run - next));
+				Output.insert(Output.end(), run, next);
+			}
+
+			run = next;
+		}
+
+		return Output.size();
+	}
+
+	// Append the bytes of an object to the output.
+	template <typename ObjectType>
+	static void Append(vector<uint8>& Output, const ObjectType& Object) {
+		const auto* bytes = (const uint8*)&Object;
+		Output.insert(Output.end(), bytes, bytes + sizeof Object);
+	}
+
+	// Append a null terminated string to the output.
+	static void AppendText(vector<uint8>& Output, const string_view Text) {
+		Output.insert(Output.end(), Text.begin(), Text.end());
+		Output.push_back(0);
 	}
 };
 
 
 // 4xReal Floating-Point Image
-// Saves to a 24/32bit Targa file.
-// Channel are in the range [0..1).
-using RImage  = TargaType<RColor>;
+// Saves to a 24/32bit Targa file, or a linear float PFM or OpenEXR file.
+// Channel are in the range [0..1) for Targa files.
+using RImage  = ImageFile<RColor>;
 
 // 4x32bit Integer Image
 // Saves to a 24/32bit Targa file.
 // Channel are in the range [0..255].
-using IImage  = TargaType<IColor>;
+using IImage  = ImageFile<IColor>;
 
 // 4x8bit Integer Image
 // Saves to a 24/32bit Targa file.
 // Channel are in the range [0..255].
-using BImage  = TargaType<BColor>;
\ No newline at end of file
+using BImage  = ImageFile<BColor>;
+
+// Background Image Writer ================================
+
+
+// Encodes and writes images on a pool of threads, so the threads
+// producing them may go straight on to their next. Images are moved
+// into a bounded queue, and queuing waits while it is full.
+template <typename FileType>
+struct ImageWriter {
+	// A Queued Image
+	struct Job {
+		string		Filename;
+		FileType	Image;
+	};
+
+	ImageFormat			Format;			// Format of the written files.
+	size_t				Capacity;		// Most images queued at once.
+
+	deque<Job>			_Queue;			// Images waiting to be written.
+	mutex				_Lock;			// Guards the queue and flags.
+	condition_variable	_Queued;		// Signaled when an image is queued, or on finishing.
+	condition_variable	_Taken;			// Signaled when an image is taken from the queue.
+	vector<thread>		_Threads;		// Writer threads.
+	bool				_Finish = false;	// Stop once the queue is empty?
+	bool				_Failed = false;	// Did any image fail to be written?
+
+	ImageWriter(const ImageFormat Format, const uint32 Threads, const size_t Capacity) :
+		Format(Format), Capacity(max(Capacity, size_t(1))) {
+		for (uint32 t = 0; t < max(Threads, 1u); t++)
+			_Threads.push_back(thread([this] { Run(); }));
+	}
+
+	ImageWriter(const ImageWriter&) = delete;
+
+	~ImageWriter() {
+		Finish();
+	}
+
+	// Queue an image to be written, waiting while the queue is full.
+	void Write(string&& Filename, FileType&& Image) {
+		unique_lock lock(_Lock);
+		_Taken.wait(lock, [&] { return _Queue.size() < Capacity; });
+		_Queue.push_back({move(Filename), move(Image)});
+		_Queued.notify_one();
+	}
+
+	// Wait for the queued images to be written, and stop the threads.
+	// Returns true if any image failed to be written.
+	bool Finish() {
+		{
+			lock_guard lock(_Lock);
+			_Finish = true;
+		}
+
+		_Queued.notify_all();
+		for (auto& thread : _Threads)
+			thread.join();
+		_Threads.clear();
+
+		return _Failed;
+	}
+
+protected:
+	// Write queued images until finished, reusing one encoding buffer.
+	void Run() {
+		vector<uint8> bytes;
+		unique_lock lock(_Lock);
+		for (;;) {
+			_Queued.wait(lock, [&] { return !_Queue.empty() || _Finish; });
+			if (_Queue.empty())
+				return;
+
+			auto job = move(_Queue.front());
+			_Queue.pop_front();
+			_Taken.notify_one();
+			lock.unlock();
+
+			job.Image.Encode(bytes, Format);
+			const auto failed = FileType::Save(job.Filename, bytes);
+
+			lock.lock();
+			_Failed |= failed;
+		}
+	}
+};
\ No newline at end of file
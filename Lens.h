@@ -18,14 +18,18 @@ struct Lens {
 	static constexpr RVector	_Ua = _U / Aperture / 2r;						// U axis scaled to aperture.
 	static constexpr RVector	_Va = _V / Aperture / 2r;						// V axis scaled to aperture.
 
+	static constexpr BoundingBox Bounds{Position - Aperture / 2r, Position + Aperture / 2r};
+
+	// Detect an intersection with the lens.
+	// Returns true if it is the nearest intersection so far.
 	template <typename StateType>
-	void HitExterior(StateType& State) const {
+	bool HitExterior(StateType& State) const {
 		// Project the lens direction on the ray direction.
 		const auto proj = Direction.Dot(State.Direction);
 		
 		// Ignore photons beyond the F-limit.
 		if (proj > _FLim)
-			return;
+			return false;
 
 		// Distance to the intersection on the lens plane.
 		const auto dist = Direction.Dot(Position - State.Position) / proj;
@@ -34,26 +38,86 @@ struct Lens {
 		// - have hit something nearer than the lens,
 		// - or are nearly coplanar with the lens.
 		if (dist >= State._HitDist || dist < Epsilon)
-			return;
+			return false;
 
 		// Compute the final intersection position.
 		const auto pos = State.Position + State.Direction * dist;
 
 		// Ignore intersections outside the lens's radius.
 		if ((pos - Position).LengthSq() >= _RadSq)
-			return;
+			return false;
 
 		// Capture the photon.
-		State.Hit(dist, [=, &State]() -> bool {
-			State.Position = pos;
+		State.Hit(dist);
+		return true;
+	}
+
+	// Detect intersections of a batch of photons with the lens.
+	template <typename BatchType>
+	void HitBatch(BatchType& Batch, const uint32 Index) const {
+		HitLanes(Batch, Index, [](const auto PX, const auto PY, const auto PZ,
+								  const auto DX, const auto DY, const auto DZ) {
+			const auto proj = Direction.x * DX + Direction.y * DY + Direction.z * DZ;
+			const auto dist = (Direction.x * (Position.x - PX) +
+							   Direction.y * (Position.y - PY) +
+							   Direction.z * (Position.z - PZ)) / proj;
+
+			const auto dx = PX + DX * dist - Position.x;
+			const auto dy = PY + DY * dist - Position.y;
+			const auto dz = PZ + DZ * dist - Position.z;
+			return pair{dist, (proj <= _FLim) & (dist >= Epsilon) &
+				(dx * dx + dy * dy + dz * dz < _RadSq)};
+		});
+	}
 
-			// Transform the photon to filmspace and capture it.
+	// Move the photon to the lens and capture it.
+	// Photons from interactions already connected to the lens are discarded.
+	template <typename StateType>
+	inline bool Interact(StateType& State) const {
+		const auto pos = State.Position += State.Direction * State._HitDist;
+
+		// Transform the photon to filmspace and capture it.
+		if (!State._Diffuse)
 			State.Film.Expose({_Ua.Dot(pos), _Va.Dot(pos),
 				_U.Dot(State.Direction), _V.Dot(State.Direction),
 				State.Color});
 
-			// Tracing continues.
-			return false;
-		});
+		// Tracing continues.
+		return false;
+	}
+
+	// Connect a diffuse interaction to a random point on the aperture.
+	// If the point is visible, the film is exposed to the photon that
+	// carries the interaction's expected contribution through it.
+	template <typename SceneType, typename StateType>
+	void Connect(const SceneType& Scene, StateType& State) const {
+		// Pick a random point on the aperture.
+		const auto disk  = State.SampleDisk() * (Aperture / 2r);
+		const auto point = Position + _U * disk.x + _V * disk.y;
+
+		// Find the direction and distance to the point.
+		auto dir = point - State.Position;
+		const auto distSq = dir.LengthSq();
+		const auto dist   = sqrt(distSq);
+		dir /= dist;
+
+		// Ignore points behind the surface or beyond the F-limit.
+		const auto cosSurf = State._HitNorm.Dot(dir);
+		const auto proj    = Direction.Dot(dir);
+		if (cosSurf <= 0r || proj > _FLim)
+			return;
+
+		// Ignore points hidden by other shapes.
+		if (Occluded(Scene, State.Position, dir, dist * (1r - 0x1p-12r)))
+			return;
+
+		// Weight the photon by the chance that a Lambertian reflection
+		// would have carried it through the aperture at this point.
+		const auto weight = cosSurf * -proj * _RadSq / distSq;
+
+		// Transform the photon to filmspace and capture it.
+		State.Film.Expose({_Ua.Dot(point), _Va.Dot(point),
+			_U.Dot(dir), _V.Dot(dir),
+			State._Deposit * weight});
 	}
 };
\ No newline at end of file
@@ -15,6 +15,7 @@ struct LightBase {
 	template <typename StateType>
 	inline void EmitColor(StateType& State) const {
 		Color::System::Emit(State.Color, Color::Color);
+		State._Diffuse = false;
 	}
 };
 
@@ -38,7 +39,7 @@ struct PointLight : LightBase<Intensity, Color> {
 	template <typename StateType>
 	void Emit(StateType& State) const {
 		State.Position	= Position;
-		State.Direction	= RandomNormal(State.RNG);
+		State.Direction	= State.SampleNormal();
 
 		this->EmitColor(State);
 	}
@@ -50,9 +51,9 @@ struct OmniSphere : LightBase<Intensity, Color> {
 	// Emit a photon.
 	template <typename StateType>
 	void Emit(StateType& State) const {
-		const auto dir	= RandomNormal(State.RNG);
+		const auto dir	= State.SampleNormal();
 		State.Position	= Position + dir * Radius;
-		State.Direction	= (dir + RandomNormal(State.RNG)).Normalized();
+		State.Direction	= (dir + State.SampleNormal()).Normalized();
 		
 		this->EmitColor(State);
 	}
@@ -8,16 +8,19 @@ template <typename ColorType>
 struct IdealDiffuse {
 	template <typename StateType, typename ShapeType>
 	static bool Interface(StateType& State, const ShapeType& Shape) {
+		// Compute the surface normal (_HitNorm).
+		Shape.HitNormal(State);
+
+		// Deposit the reflected color for a connection to the lens.
+		State.Deposit(State.Color * ColorType::Color);
+
 		// Will this photon be absorbed?
-		if (ColorType::System::Absorb(State.Color, ColorType::Color))
+		if (ColorType::System::Absorb(State.Color, ColorType::Color, State.Sample()))
 			// If so, terminate the trace.
 			return false;
 
-		// Compute the surface normal (_HitNorm).
-		Shape.HitNormal(State);
-
 		// Compute Lambertian reflection.
-		State.Direction = (State._HitNorm + RandomNormal(State.RNG)).Normalized();
+		State.Direction = (State._HitNorm + State.SampleNormal()).Normalized();
 		
 		// Continue tracing.
 		return true;
@@ -31,7 +34,9 @@ struct IdealMirror {
 		Shape.HitNormal(State);
 
 		// Compute a perfect reflection.
+		// Specular reflections cannot be connected to the lens.
 		State.Direction -= State._HitNorm * State.Direction.Dot(State._HitNorm) * 2r;
+		State._Diffuse = false;
 
 		// Continue tracing.
 		return true;
@@ -45,12 +50,16 @@ struct ShinyOpaque {
 		// Compute the surface normal (_HitNorm).
 		Shape.HitNormal(State);
 
-		if (State.PoolRNG() <= Specular)
+		// Deposit the diffusely reflected color for a connection to the lens.
+		State.Deposit(State.Color * ColorType::Color * (1r - Specular));
+
+		if (State.Sample() <= Specular) {
 			// Specular reflection.
 			State.Direction -= State._HitNorm * State.Direction.Dot(State._HitNorm) * 2r;
-		else if (!ColorType::System::Absorb(State.Color, ColorType::Color))
+			State._Diffuse = false;
+		} else if (!ColorType::System::Absorb(State.Color, ColorType::Color, State.Sample()))
 			// Diffuse reflection.
-			State.Direction = (State._HitNorm + RandomNormal(State.RNG)).Normalized();
+			State.Direction = (State._HitNorm + State.SampleNormal()).Normalized();
 		else
 			// Photon was absorbed. Terminate the trace.
 			return false;
@@ -0,0 +1,577 @@
+#pragma once
+
+
+// Triangle Meshes ========================================
+// Unlike the basic shapes, a mesh is loaded from a file at
+// startup. Wavefront OBJ files are parsed and triangulated,
+// and the triangles are organized into a bounding volume
+// hierarchy built with the surface area heuristic (SAH).
+// The result is cached beside the OBJ file in a compact
+// binary format (a DataStream holding one TAG_Mesh block)
+// which loads without any parsing or building. Triangles
+// are two-sided and intersected watertight, so photons
+// never slip through the edges shared by neighbors.
+
+
+// Mesh Triangle (48 bytes)
+struct MeshTriangle {
+	Real	V[3][3];		// Vertex positions.
+	Real	Normal[3];		// Unit geometric normal.
+};
+
+// Flattened BVH Node (32 bytes, two per cache line)
+// Nodes are stored depth-first, so an interior node's first
+// child immediately follows it.
+struct MeshNode {
+	Real	Min[3];			// Bounds of every triangle beneath the node.
+	uint32	Index;			// Interior: second child. Leaf: first triangle.
+	Real	Max[3];
+	uint32	Count : 30;		// Leaf: number of triangles. Interior: zero.
+	uint32	Axis  : 2;		// Interior: axis the children were split along.
+};
+
+// Mesh Bounding Box
+struct MeshBounds {
+	Real	Min[3] = { Infinity,  Infinity,  Infinity};
+	Real	Max[3] = {-Infinity, -Infinity, -Infinity};
+
+	inline void Grow(const Real Point[3]) {
+		for (int k = 0; k < 3; k++) {
+			Min[k] = min(Min[k], Point[k]);
+			Max[k] = max(Max[k], Point[k]);
+		}
+	}
+
+	// Enclose another box; an empty box leaves this one unchanged.
+	inline void Grow(const MeshBounds& Other) {
+		if (Other.Min[0] > Other.Max[0])
+			return;
+		Grow(Other.Min);
+		Grow(Other.Max);
+	}
+
+	// Return half the surface area of the box.
+	[[nodiscard]] inline Real Area() const {
+		const Real dx = Max[0] - Min[0], dy = Max[1] - Min[1], dz = Max[2] - Min[2];
+		return Min[0] > Max[0] ? 0r : dx * dy + dy * dz + dz * dx;
+	}
+};
+
+// A Ray Prepared for Mesh Traversal
+struct MeshRay {
+	Real	Origin[3];		// Ray origin.
+	Real	InvDir[3];		// Reciprocal of the ray's direction.
+	bool	Negative[3];	// Does the ray travel towards -axis?
+	int		X, Y, Z;		// Axes permuted so Z is the dominant direction.
+	Real	Sx, Sy, Sz;		// Shear and scale into ray space.
+
+	MeshRay(const RVector& Position, const RVector& Direction) :
+		Origin{Position.x, Position.y, Position.z} {
+		const Real dir[3] = {Direction.x, Direction.y, Direction.z};
+		for (int k = 0; k < 3; k++) {
+			InvDir[k]   = 1r / dir[k];
+			Negative[k] = dir[k] < 0r;
+		}
+
+		// Permute the axes so the dominant direction is along Z,
+		// preserving the winding of the triangles.
+		const auto ax = abs(dir[0]), ay = abs(dir[1]), az = abs(dir[2]);
+		Z = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+		X = (Z + 1) % 3;
+		Y = (X + 1) % 3;
+		if (Negative[Z])
+			swap(X, Y);
+
+		Sx = dir[X] / dir[Z];
+		Sy = dir[Y] / dir[Z];
+		Sz = 1r     / dir[Z];
+	}
+
+	// Detect an intersection with the node's bounds nearer than the supplied distance.
+	[[nodiscard]] inline bool Hit(const MeshNode& Node, const Real Distance) const {
+		// Widen the far distance slightly so rounding never misses a box.
+		constexpr Real Robust = 1r + 4r * numeric_limits<Real>::epsilon();
+
+		Real near = 0r, far = Distance;
+		for (int k = 0; k < 3; k++) {
+			const auto t1 = (Node.Min[k] - Origin[k]) * InvDir[k];
+			const auto t2 = (Node.Max[k] - Origin[k]) * InvDir[k];
+			near = max(near, min(t1, t2));
+			far  = min(far,  max(t1, t2) * Robust);
+		}
+		return near <= far;
+	}
+
+	// Detect an intersection with the triangle nearer than the supplied distance.
+	// Uses the watertight test of Woop, Benthin and Wald (2013).
+	// Returns true if it is nearer, updating the distance.
+	[[nodiscard]] inline bool Hit(const MeshTriangle& Triangle, Real& Distance) const {
+		// Translate the vertices relative to the ray's origin.
+		Real a[3], b[3], c[3];
+		for (int k = 0; k < 3; k++) {
+			a[k] = Triangle.V[0][k] - Origin[k];
+			b[k] = Triangle.V[1][k] - Origin[k];
+			c[k] = Triangle.V[2][k] - Origin[k];
+		}
+
+		// Shear the vertices so the ray runs along +Z.
+		const auto ax = a[X] - Sx * a[Z], ay = a[Y] - Sy * a[Z];
+		const auto bx = b[X] - Sx * b[Z], by = b[Y] - Sy * b[Z];
+		const auto cx = c[X] - Sx * c[Z], cy = c[Y] - Sy * c[Z];
+
+		// Compute the scaled barycentric coordinates.
+		auto u = cx * by - cy * bx;
+		auto v = ax * cy - ay * cx;
+		auto w = bx * ay - by * ax;
+
+		// On an edge, recompute them in double precision.
+		if (u == 0r || v == 0r || w == 0r) {
+			u = Real(float64(cx) * by - float64(cy) * bx);
+			v = Real(float64(ax) * cy - float64(ay) * cx);
+			w = Real(float64(bx) * ay - float64(by) * ax);
+		}
+
+		// Both faces are hit, so only mixed signs miss.
+		if ((u < 0r || v < 0r || w < 0r) && (u > 0r || v > 0r || w > 0r))
+			return false;
+
+		const auto det = u + v + w;
+		if (det == 0r)
+			return false;
+
+		// Compute the distance to the intersection.
+		const auto dist = (u * a[Z] + v * b[Z] + w * c[Z]) * Sz / det;
+		if (dist < Epsilon || dist >= Distance)
+			return false;
+
+		Distance = dist;
+		return true;
+	}
+};
+
+// Mesh Geometry and Hierarchy
+struct MeshData {
+	static constexpr uint32	MaxLeaf  = 4;		// Triangles per leaf, unless splitting costs more.
+	static constexpr uint32	MaxDepth = 64;		// Deepest node, which bounds the traversal stack.
+	static constexpr uint32	Bins     = 16;		// SAH bins per axis.
+
+	// Binary Mesh Header
+	struct MeshHeader : BlockHeader {
+		uint32	Triangles = 0;
+		uint32	Nodes     = 0;
+
+		MeshHeader() = default;
+
+		MeshHeader(const uint32 Triangles, const uint32 Nodes) :
+			BlockHeader(TAG_Mesh, Bytes(Triangles, Nodes)),
+			Triangles(Triangles), Nodes(Nodes) {}
+
+		// Return the size of a block with the supplied contents.
+		static constexpr uint64 Bytes(const uint64 Triangles, const uint64 Nodes) {
+			return sizeof MeshHeader + Triangles * sizeof MeshTriangle + Nodes * sizeof MeshNode;
+		}
+
+		[[nodiscard]] inline bool Validate() const {
+			return BlockHeader::Validate() || Ident != TAG_Mesh ||
+				Size != Bytes(Triangles, Nodes);
+		}
+	};
+
+	vector<MeshTriangle>	Triangles;		// Triangles, in leaf order once built.
+	vector<MeshNode>		Nodes;			// Hierarchy, root first.
+	Real					Offset = 0r;	// Distance photons are lifted off the surface.
+
+	// Load a mesh from an OBJ file (via its binary cache) or a binary file.
+	// Returns true on error.
+	bool Load(const path& Filename) {
+		if (Filename.extension() != ".obj")
+			return LoadBinary(Filename);
+
+		// Use the binary cache if it is at least as new as the OBJ file.
+		auto cache = Filename;
+		cache.replace_extension(".srm");
+
+		error_code error;
+		const auto source = last_write_time(Filename, error);
+		if (error)
+			return true;
+
+		const auto cached = last_write_time(cache, error);
+		if (!error && cached >= source && !LoadBinary(cache))
+			return false;
+
+		if (LoadOBJ(Filename))
+			return true;
+
+		// Build the hierarchy and cache it. A failure to cache is harmless.
+		Build();
+		SaveBinary(cache);
+		return false;
+	}
+
+	// Load and triangulate the faces of an OBJ file.
+	// Only vertex positions and faces are used.
+	// Returns true on error.
+	bool LoadOBJ(const path& Filename) {
+		ifstream file(Filename, ios::binary);
+		if (!file.is_open())
+			return true;
+
+		const string text{istreambuf_iterator<char>(file), istreambuf_iterator<char>()};
+		if (file.bad())
+			return true;
+
+		vector<array<Real, 3>> vertices;
+		Triangles.clear();
+		Nodes.clear();
+
+		const char* pos = text.data();
+		const char* const end = pos + text.size();
+
+		// Skip spaces and tabs on the current line.
+		const auto skip = [&] {
+			while (pos < end && (*pos == ' ' || *pos == '\t'))
+				pos++;
+		};
+
+		for (; pos < end; pos++) {
+			skip();
+			if (end - pos > 2 && pos[0] == 'v' && (pos[1] == ' ' || pos[1] == '\t')) {
+				// Vertex position.
+				pos++;
+				auto& vertex = vertices.emplace_back();
+				for (auto& coord : vertex) {
+					skip();
+					const auto result = from_chars(pos, end, coord);
+					if (result.ec != errc{})
+						return true;
+					pos = result.ptr;
+				}
+			} else if (end - pos > 2 && pos[0] == 'f' && (pos[1] == ' ' || pos[1] == '\t')) {
+				// Face, triangulated as a fan around its first vertex.
+				pos++;
+				uint32 face[3], corners = 0;
+				for (;;) {
+					skip();
+					int64 index;
+					const auto result = from_chars(pos, end, index);
+					if (result.ec != errc{})
+						break;
+					pos = result.ptr;
+
+					// Skip texture and normal indices.
+					while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n')
+						pos++;
+
+					// Resolve relative indices.
+					index = index < 0 ? int64(vertices.size()) + index : index - 1;
+					if (index < 0 || index >= int64(vertices.size()))
+						return true;
+
+					face[min(corners++, 2u)] = uint32(index);
+					if (corners >= 3) {
+						AddTriangle(vertices[face[0]].data(), vertices[face[1]].data(), vertices[face[2]].data());
+						face[1] = face[2];
+					}
+				}
+			}
+
+			// Skip to the end of the line.
+			while (pos < end && *pos != '\n')
+				pos++;
+		}
+
+		return Triangles.empty();
+	}
+
+	// Load a mesh and its hierarchy from a binary file.
+	// Returns true on error.
+	bool LoadBinary(const path& Filename) {
+		DataStream data;
+		MeshHeader hdr;
+		if (data.Open(Filename, true) || data.Seek(TAG_Mesh) || data.ReadHeader(hdr) || !hdr.Nodes)
+			return true;
+
+		Triangles.resize(hdr.Triangles);
+		Nodes.resize(hdr.Nodes);
+		if (data.Read(Triangles.data(), Triangles.size()) || data.Read(Nodes.data(), Nodes.size()))
+			return true;
+
+		ComputeOffset();
+		return false;
+	}
+
+	// Save the mesh and its hierarchy to a binary file.
+	// Returns true on error.
+	bool SaveBinary(const path& Filename) const {
+		if (MeshHeader::Bytes(Triangles.size(), Nodes.size()) >= (1ull << 32))
+			return true;
+
+		DataStream data;
+		return data.New(Filename) ||
+			data.WriteHeader(MeshHeader(uint32(Triangles.size()), uint32(Nodes.size()))) ||
+			data.Write(Triangles.data(), Triangles.size()) ||
+			data.Write(Nodes.data(), Nodes.size()) ||
+			data.Close();
+	}
+
+	// Append a triangle, skipping degenerate ones.
+	void AddTriangle(const Real* A, const Real* B, const Real* C) {
+		const RVector a{A[0], A[1], A[2]}, b{B[0], B[1], B[2]}, c{C[0], C[1], C[2]};
+		if (a == b || b == c || c == a)
+			return;
+
+		const auto normal = (b - a).Cross(c - a);
+		const auto length = normal.Length();
+		if (!(length > 0r))
+			return;
+
+		Triangles.push_back({
+			{{A[0], A[1], A[2]}, {B[0], B[1], B[2]}, {C[0], C[1], C[2]}},
+			{normal.x / length, normal.y / length, normal.z / length}});
+	}
+
+	// Build the hierarchy, reordering the triangles into leaf order.
+	void Build() {
+		const auto count = uint32(Triangles.size());
+
+		// Bound each triangle and find its centroid.
+		vector<MeshBounds> bounds(count);
+		vector<array<Real, 3>> centers(count);
+		for (uint32 tri = 0; tri < count; tri++) {
+			for (const auto& vertex : Triangles[tri].V)
+				bounds[tri].Grow(vertex);
+
+			for (int k = 0; k < 3; k++)
+				centers[tri][k] = (bounds[tri].Min[k] + bounds[tri].Max[k]) / 2r;
+		}
+
+		vector<uint32> order(count);
+		iota(order.begin(), order.end(), 0u);
+
+		Nodes.clear();
+		Nodes.reserve(size_t(count) / 2 + 1);
+		if (count)
+			BuildNode(order, bounds, centers, 0, count, 1);
+
+		// Store the triangles in the order the leaves refer to them.
+		vector<MeshTriangle> sorted(count);
+		for (uint32 tri = 0; tri < count; tri++)
+			sorted[tri] = Triangles[order[tri]];
+
+		Triangles = move(sorted);
+		ComputeOffset();
+	}
+
+	// Build the subtree over a range of triangles. Returns the node's index.
+	uint32 BuildNode(vector<uint32>& Order, const vector<MeshBounds>& Bounds,
+		const vector<array<Real, 3>>& Centers, const uint32 Begin, const uint32 End, const uint32 Depth) {
+		// Bound the triangles and their centroids.
+		MeshBounds box, centroids;
+		for (auto item = Begin; item < End; item++) {
+			box.Grow(Bounds[Order[item]]);
+			centroids.Grow(Centers[Order[item]].data());
+		}
+
+		const auto node = uint32(Nodes.size());
+		auto& n = Nodes.emplace_back();
+		copy_n(box.Min, 3, n.Min);
+		copy_n(box.Max, 3, n.Max);
+		n.Index = Begin;
+		n.Count = End - Begin;
+		n.Axis  = 0;
+
+		const auto count = End - Begin;
+		if (count <= MaxLeaf || Depth >= MaxDepth)
+			return node;
+
+		// Find the cheapest split between bins along any axis.
+		// Costs are relative to intersecting one triangle.
+		auto bestCost = Real(count);
+		uint32 bestAxis = 0, bestSplit = 0;
+		for (uint32 axis = 0; axis < 3; axis++) {
+			const auto extent = centroids.Max[axis] - centroids.Min[axis];
+			if (!(extent > 0r))
+				continue;
+
+			const auto scale = Bins * (1r - 1e-6r) / extent;
+			MeshBounds binBounds[Bins];
+			uint32 binCounts[Bins] = {};
+			for (auto item = Begin; item < End; item++) {
+				const auto tri = Order[item];
+				const auto bin = min(Bins - 1, uint32((Centers[tri][axis] - centroids.Min[axis]) * scale));
+				binBounds[bin].Grow(Bounds[tri]);
+				binCounts[bin]++;
+			}
+
+			// Sweep from the right, then from the left.
+			Real rightArea[Bins];
+			uint32 rightCount[Bins];
+			MeshBounds right;
+			for (uint32 bin = Bins - 1, total = 0; bin > 0; bin--) {
+				right.Grow(binBounds[bin]);
+				total += binCounts[bin];
+				rightArea[bin]  = right.Area();
+				rightCount[bin] = total;
+			}
+
+			MeshBounds left;
+			for (uint32 split = 1, total = 0; split < Bins; split++) {
+				left.Grow(binBounds[split - 1]);
+				total += binCounts[split - 1];
+
+				const auto cost = 1r + (left.Area() * total + rightArea[split] * rightCount[split]) / box.Area();
+				if (total && rightCount[split] && cost < bestCost) {
+					bestCost  = cost;
+					bestAxis  = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// Partition the triangles by bin, or at the median centroid along the widest
+		// axis if no split is cheaper yet the range is too large for a leaf.
+		auto mid = Begin + count / 2;
+		if (bestSplit) {
+			const auto extent = centroids.Max[bestAxis] - centroids.Min[bestAxis];
+			const auto scale = Bins * (1r - 1e-6r) / extent;
+			mid = uint32(partition(Order.begin() + Begin, Order.begin() + End, [&](const uint32 Tri) {
+				return min(Bins - 1, uint32((Centers[Tri][bestAxis] - centroids.Min[bestAxis]) * scale)) < bestSplit;
+			}) - Order.begin());
+		} else if (count <= MaxLeaf * 4)
+			return node;
+		else {
+			for (uint32 axis = 1; axis < 3; axis++)
+				if (centroids.Max[axis] - centroids.Min[axis] > centroids.Max[bestAxis] - centroids.Min[bestAxis])
+					bestAxis = axis;
+			nth_element(Order.begin() + Begin, Order.begin() + mid, Order.begin() + End, [&](const uint32 A, const uint32 B) {
+				return Centers[A][bestAxis] < Centers[B][bestAxis];
+			});
+		}
+
+		Nodes[node].Count = 0;
+		Nodes[node].Axis  = bestAxis;
+		BuildNode(Order, Bounds, Centers, Begin, mid, Depth + 1);
+		Nodes[node].Index = BuildNode(Order, Bounds, Centers, mid, End, Depth + 1);
+		return node;
+	}
+
+	// Lift photons off the surface by a few units in the last place of the largest coordinate.
+	void ComputeOffset() {
+		Real extent = 0r;
+		if (!Nodes.empty())
+			for (int k = 0; k < 3; k++)
+				extent = max({extent, abs(Nodes[0].Min[k]), abs(Nodes[0].Max[k])});
+
+		Offset = extent * 0x1p-20r;
+	}
+
+	// Find the nearest triangle intersected by the ray nearer than the supplied distance.
+	// Returns true if one was found, updating the distance and triangle index.
+	bool Intersect(const RVector& Position, const RVector& Direction, Real& Distance, uint32& Triangle) const {
+		if (Nodes.empty())
+			return false;
+
+		const MeshRay ray(Position, Direction);
+		bool hit = false;
+
+		uint32 stack[MaxDepth];
+		uint32 depth = 0;
+		for (uint32 node = 0;;) {
+			const auto& n = Nodes[node];
+			if (ray.Hit(n, Distance)) {
+				if (!n.Count) {
+					// Visit the nearer child first, deferring the other.
+					if (ray.Negative[n.Axis]) {
+						stack[depth++] = node + 1;
+						node = n.Index;
+					} else {
+						stack[depth++] = n.Index;
+						node++;
+					}
+					continue;
+				}
+
+				for (auto tri = n.Index; tri < n.Index + n.Count; tri++)
+					if (ray.Hit(Triangles[tri], Distance)) {
+						Triangle = tri;
+						hit = true;
+					}
+			}
+
+			if (!depth)
+				break;
+
+			node = stack[--depth];
+		}
+
+		return hit;
+	}
+};
+
+// Triangle Mesh Shape
+// The mesh is loaded by Load() before rendering, from a file
+// named relative to the working directory.
+template <FixedString Filename, typename Material>
+struct Mesh {
+	using MaterialType = Material;
+
+	inline static MeshData _Data;
+
+	// Load the mesh.
+	// Returns true on error.
+	static bool Load() {
+		return _Data.Load(path(Filename.Chars));
+	}
+
+	// Detect an intersection with either face of the mesh.
+	// Returns true if it is the nearest intersection so far.
+	template <typename StateType>
+	bool HitExterior(StateType& State) const {
+		auto dist = State._HitDist;
+		uint32 tri;
+		if (!_Data.Intersect(State.Position, State.Direction, dist, tri))
+			return false;
+
+		State.Hit(dist);
+		State._HitPrim = tri;
+		return true;
+	}
+
+	// Detect intersections of a batch of photons with the mesh, one photon at a time.
+	template <typename BatchType>
+	void HitBatch(BatchType& Batch, const uint32 Index) const {
+		for (uint32 i = 0; i < Batch.Count; i++) {
+			auto dist = Batch.HitDist[i];
+			uint32 tri;
+			if (_Data.Intersect({Batch.PosX[i], Batch.PosY[i], Batch.PosZ[i]},
+				{Batch.DirX[i], Batch.DirY[i], Batch.DirZ[i]}, dist, tri)) {
+				Batch.HitDist [i] = dist;
+				Batch.HitShape[i] = Index;
+				Batch.HitPrim [i] = tri;
+			}
+		}
+	}
+
+	// Move the photon to the intersection and apply the material.
+	template <typename StateType>
+	inline bool Interact(StateType& State) const {
+		State.Position += State.Direction * State._HitDist;
+		const auto alive = Material::Interface(State, *this);
+
+		// Lift the photon off the side it arrived from (which reflections
+		// leave from), so neither it nor a lens connection can intersect
+		// the same triangle again.
+		State.Position += State._HitNorm * _Data.Offset;
+		return alive;
+	}
+
+	// Return the normal of the intersected triangle, facing the photon.
+	template <typename StateType>
+	inline void HitNormal(StateType& State) const {
+		const auto& normal = _Data.Triangles[State._HitPrim].Normal;
+		State._HitNorm = {normal[0], normal[1], normal[2]};
+		if (State._HitNorm.Dot(State.Direction) > 0r)
+			State._HitNorm = -State._HitNorm;
+	}
+};
\ No newline at end of file
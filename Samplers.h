@@ -0,0 +1,239 @@
+#pragma once
+
+
+// Photon Samplers ========================================
+// Every random decision made while tracing a photon draws
+// from the trace state's sampler. A sampler is started at
+// the index of each photon, then hands out one sample per
+// dimension in the order they are drawn: emission first,
+// then each bounce. The pseudorandom sampler draws from the
+// thread's Xoroshiro generator and ignores both. The quasi-
+// random samplers compute each sample from the photon index
+// and dimension alone, so successive photons fill the sample
+// space far more evenly than independent random numbers do.
+// Their sequences are scrambled, which keeps the estimates
+// unbiased and lets independent renders be compared.
+
+
+// Hashing Utilities ======================================
+
+
+// Mix the bits of a 32-bit integer (lowbias32 by Chris Wellons).
+[[nodiscard]] constexpr uint32 Hash32(uint32 Value) {
+	Value ^= Value >> 16; Value *= 0x7FEB352Du;
+	Value ^= Value >> 15; Value *= 0x846CA68Bu;
+	return Value ^ (Value >> 16);
+}
+
+// Combine a seed with a value into a new seed.
+[[nodiscard]] constexpr uint32 HashCombine(const uint32 Seed, const uint32 Value) {
+	return Seed ^ (Hash32(Value) + 0x9E3779B9u + (Seed << 6) + (Seed >> 2));
+}
+
+// Reverse the order of the bits of a 32-bit integer.
+[[nodiscard]] constexpr uint32 ReverseBits(uint32 Value) {
+	Value = (Value << 16) | (Value >> 16);
+	Value = ((Value & 0x00FF00FFu) << 8) | ((Value >> 8) & 0x00FF00FFu);
+	Value = ((Value & 0x0F0F0F0Fu) << 4) | ((Value >> 4) & 0x0F0F0F0Fu);
+	Value = ((Value & 0x33333333u) << 2) | ((Value >> 2) & 0x33333333u);
+	return ((Value & 0x55555555u) << 1) | ((Value >> 1) & 0x55555555u);
+}
+
+// Owen-scramble the binary digits of a 32-bit fixed-point fraction.
+// Each digit is flipped by a hash of the digits above it.
+// See "Practical Hash-based Owen Scrambling" (Burley, 2020).
+[[nodiscard]] constexpr uint32 OwenScramble(uint32 Value, const uint32 Seed) {
+	Value  = ReverseBits(Value);
+	Value += Seed;
+	Value ^= Value * 0x6C50B47Cu;
+	Value ^= Value * 0xB82F1E52u;
+	Value ^= Value * 0xC7AFE638u;
+	Value ^= Value * 0x8D22F6E6u;
+	return ReverseBits(Value);
+}
+
+// Convert a 32-bit fixed-point fraction to a Real in the range [0..1).
+[[nodiscard]] constexpr Real UnitReal(const uint32 Value) {
+	return Real(Value >> 8) * 0x1p-24r;
+}
+
+
+// Sequences ==============================================
+// A sequence computes the sample of a photon in a dimension,
+// randomized by a scramble seed.
+
+
+// Sobol Sequence
+// Owen-scrambled 4D Sobol points. Higher dimensions are padded
+// with further 4D blocks, each scrambled and shuffled by its own
+// seed, so any number of dimensions may be drawn.
+struct SobolSequence {
+	static constexpr uint32 Dimensions = 4;		// Dimensions per block.
+
+	// Generator matrices, as the direction number of each index bit.
+	// Primitive polynomials and initial numbers from Joe and Kuo (2008).
+	static constexpr auto Directions = [] {
+		struct Polynomial { uint32 Degree, Coeffs, Initial[3]; };
+		constexpr Polynomial polys[Dimensions - 1] = {{1, 0, {1}}, {2, 1, {1, 3}}, {3, 1, {1, 3, 1}}};
+
+		array<array<uint32, 32>, Dimensions> dirs{};
+		for (uint32 bit = 0; bit < 32; bit++)
+			dirs[0][bit] = 1u << (31 - bit);
+
+		for (uint32 dim = 1; dim < Dimensions; dim++) {
+			const auto& poly = polys[dim - 1];
+			auto& v = dirs[dim];
+			for (uint32 bit = 0; bit < 32; bit++) {
+				if (bit < poly.Degree) {
+					v[bit] = poly.Initial[bit] << (31 - bit);
+					continue;
+				}
+
+				v[bit] = v[bit - poly.Degree] ^ (v[bit - poly.Degree] >> poly.Degree);
+				for (uint32 k = 1; k < poly.Degree; k++)
+					if ((poly.Coeffs >> (poly.Degree - 1 - k)) & 1)
+						v[bit] ^= v[bit - k];
+			}
+		}
+
+		return dirs;
+	}();
+
+	// Direction numbers combined for every value of each byte of an index.
+	static constexpr auto Bytes = [] {
+		array<array<array<uint32, 256>, 4>, Dimensions> bytes{};
+		for (uint32 dim = 0; dim < Dimensions; dim++)
+			for (uint32 byte = 0; byte < 4; byte++)
+				for (uint32 value = 0; value < 256; value++)
+					for (uint32 bit = 0; bit < 8; bit++)
+						if (value & (1u << bit))
+							bytes[dim][byte][value] ^= Directions[dim][byte * 8 + bit];
+		return bytes;
+	}();
+
+	// Return the unscrambled Sobol point of an index in one dimension of a block.
+	[[nodiscard]] static inline uint32 Point(const uint32 Index, const uint32 Dimension) {
+		const auto& bytes = Bytes[Dimension];
+		return bytes[0][Index & 0xFF] ^ bytes[1][(Index >> 8) & 0xFF] ^
+			bytes[2][(Index >> 16) & 0xFF] ^ bytes[3][Index >> 24];
+	}
+
+	// Return the sample of a photon in a dimension.
+	[[nodiscard]] static inline Real Sample(const uint64 Photon, const uint32 Dimension, const uint32 Scramble) {
+		// Each block, and each 2^32 photons, has its own seed.
+		const auto seed  = HashCombine(HashCombine(Scramble, Dimension / Dimensions), uint32(Photon >> 32));
+
+		// Shuffle the photons of the block, then scramble the point.
+		const auto index = OwenScramble(uint32(Photon), seed);
+		const auto dim   = Dimension % Dimensions;
+		return UnitReal(OwenScramble(Point(index, dim), HashCombine(seed, dim + 1)));
+	}
+};
+
+// Halton Sequence
+// Radical inverses in successive prime bases. Digits are scrambled
+// by a shift hashed from the digits above them, a cheap variant of
+// Owen scrambling. Dimensions beyond the table of primes, where the
+// sequence degrades, fall back to hashed random samples.
+struct HaltonSequence {
+	static constexpr array<uint32, 32> Primes = {
+		  2,   3,   5,   7,  11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,  53,
+		 59,  61,  67,  71,  73,  79,  83,  89,  97, 101, 103, 107, 109, 113, 127, 131};
+
+	// Return the sample of a photon in a dimension.
+	[[nodiscard]] static inline Real Sample(uint64 Photon, const uint32 Dimension, const uint32 Scramble) {
+		auto seed = HashCombine(Scramble, Dimension);
+		if (Dimension >= Primes.size())
+			return UnitReal(Hash32(HashCombine(HashCombine(seed, uint32(Photon)), uint32(Photon >> 32))));
+
+		// Reflect the scrambled digits about the radix point, until
+		// they fall below the precision of a Real.
+		const auto base = Primes[Dimension];
+		const auto inv  = 1.0 / base;
+		float64 value = 0;
+		for (auto scale = inv; scale > 0x1p-24; scale *= inv) {
+			const auto digit = uint32(Photon % base);
+			Photon /= base;
+
+			value += float64((digit + Hash32(seed)) % base) * scale;
+			seed   = HashCombine(seed, digit);
+		}
+
+		return min(Real(value), 0x1.FFFFFEp-1r);
+	}
+};
+
+
+// Samplers ===============================================
+// Samplers provide a common interface for the trace state:
+// Start() begins a photon, and Next(), Normal() and Disk()
+// draw a Real in [0..1), a unit vector, and a point in the
+// unit disk. Samplers are copied along with their photons.
+
+
+// Pseudorandom Sampler
+// Draws every sample from the thread's pool of random Reals.
+struct PseudoSampler {
+	inline void Start(const uint64, const uint32) {}
+
+	template <typename StateType>
+	inline Real Next(StateType& State) {
+		return State.RNG();
+	}
+
+	template <typename StateType>
+	inline RVector Normal(StateType& State) {
+		return RandomNormal(State.RNG);
+	}
+
+	template <typename StateType>
+	inline RVector Disk(StateType& State) {
+		return RandomInDisk(State.RNG);
+	}
+};
+
+// Quasi-Random Sampler
+// Draws each sample from a sequence, at the photon's index and the next dimension.
+template <typename SequenceType>
+struct QuasiSampler {
+	uint64	_Photon = 0;		// Index of the photon in the sequence.
+	uint32	_Scramble = 0;		// Scramble seed of the photon's sequence.
+	uint32	_Dimension = 0;		// Next dimension to be drawn.
+
+	// Start drawing the samples of a photon.
+	inline void Start(const uint64 Photon, const uint32 Scramble) {
+		_Photon    = Photon;
+		_Scramble  = Scramble;
+		_Dimension = 0;
+	}
+
+	template <typename StateType>
+	inline Real Next(StateType&) {
+		return SequenceType::Sample(_Photon, _Dimension++, _Scramble);
+	}
+
+	template <typename StateType>
+	inline RVector Normal(StateType&) {
+		const auto [u, v] = Next2D();
+		return UniformNormal(u, v);
+	}
+
+	template <typename StateType>
+	inline RVector Disk(StateType&) {
+		const auto [u, v] = Next2D();
+		return UniformDisk(u, v);
+	}
+
+protected:
+	// Draw a pair of samples. Pairs begin on an even dimension,
+	// so they never straddle two blocks of a padded sequence.
+	inline pair<Real, Real> Next2D() {
+		_Dimension = (_Dimension + 1) & ~1u;
+		const auto u = SequenceType::Sample(_Photon, _Dimension++, _Scramble);
+		const auto v = SequenceType::Sample(_Photon, _Dimension++, _Scramble);
+		return {u, v};
+	}
+};
+
+using SobolSampler  = QuasiSampler<SobolSequence>;
+using HaltonSampler = QuasiSampler<HaltonSequence>;
\ No newline at end of file
@@ -0,0 +1,355 @@
+#pragma once
+
+
+// Scene Utilities ========================================
+// A scene is a tuple of shapes. Shapes are identified by
+// their index in the tuple, which allows tracers to record
+// the nearest intersection compactly and dispatch to its
+// shape's interface without type erasure.
+
+
+// Identifies a photon which has not intersected any shape.
+constexpr uint32 NoShape = ~0u;
+
+// Call the supplied function on each shape, along with its index.
+template <typename SceneType, typename LambdaFunc>
+inline void ForEachShape(const SceneType& Scene, LambdaFunc&& Func) {
+	[&]<size_t... Index>(index_sequence<Index...>) {
+		(Func(get<Index>(Scene), uint32(Index)), ...);
+	}(make_index_sequence<tuple_size_v<SceneType>>{});
+}
+
+// Material of a shape. Shapes without one, such as lenses,
+// stand in for their own material.
+template <typename ShapeType>
+struct ShapeMaterial {
+	using Type = ShapeType;
+};
+
+template <typename ShapeType>
+requires requires { typename ShapeType::MaterialType; }
+struct ShapeMaterial<ShapeType> {
+	using Type = ShapeType::MaterialType;
+};
+
+// Scene index of the first shape with the same material as the shape.
+template <typename SceneType, size_t Shape>
+constexpr uint32 MaterialGroup = []<size_t... Other>(index_sequence<Other...>) {
+	using MaterialType = ShapeMaterial<tuple_element_t<Shape, SceneType>>::Type;
+
+	uint32 first = uint32(Shape);
+	((is_same_v<typename ShapeMaterial<tuple_element_t<Other, SceneType>>::Type, MaterialType> ?
+		void(first = min(first, uint32(Other))) : void()), ...);
+	return first;
+}(make_index_sequence<Shape>{});
+
+// Rank of each shape, by scene index, when the shapes are ordered
+// by material and then by index. Shapes sharing a material rank
+// consecutively. Materials are ordered by their first shape.
+template <typename SceneType>
+constexpr auto MaterialRank = []<size_t... Shape>(index_sequence<Shape...>) {
+	constexpr array<uint32, sizeof...(Shape)> group{MaterialGroup<SceneType, Shape>...};
+
+	array<uint32, sizeof...(Shape)> rank{};
+	for (uint32 shape = 0; shape < group.size(); shape++)
+		for (uint32 other = 0; other < group.size(); other++)
+			rank[shape] += pair{group[other], other} < pair{group[shape], shape};
+	return rank;
+}(make_index_sequence<tuple_size_v<SceneType>>{});
+
+// Load the data of any shapes which are loaded at runtime, such as meshes.
+// Returns true on error.
+template <typename SceneType>
+inline bool LoadScene(const SceneType& Scene) {
+	bool error = false;
+	ForEachShape(Scene, [&error](const auto& Shape, const uint32) {
+		using ShapeType = remove_cvref_t<decltype(Shape)>;
+		if constexpr (requires { ShapeType::Load(); })
+			error = error || ShapeType::Load();
+	});
+	return error;
+}
+
+// Detect an intersection with the shape at the supplied index.
+// Dispatches through a jump table generated at compile time.
+// Returns true if it is the nearest intersection so far.
+template <typename SceneType, typename StateType>
+inline bool HitExterior(const SceneType& Scene, const uint32 Index, StateType& State) {
+	using FuncType = bool (*)(const SceneType&, StateType&);
+
+	static constexpr auto table = []<size_t... Shape>(index_sequence<Shape...>) {
+		return array<FuncType, sizeof...(Shape)>{
+			[](const SceneType& Scene, StateType& State) {
+				return get<Shape>(Scene).HitExterior(State);
+			}...
+		};
+	}(make_index_sequence<tuple_size_v<SceneType>>{});
+
+	assert(Index < table.size());
+	return table[Index](Scene, State);
+}
+
+// Move the photon to its intersection with the shape at the supplied
+// index and invoke the shape's interface. Dispatches through a jump
+// table generated at compile time.
+// Returns true if tracing should continue.
+template <typename SceneType, typename StateType>
+inline bool Interact(const SceneType& Scene, const uint32 Index, StateType& State) {
+	using FuncType = bool (*)(const SceneType&, StateType&);
+
+	static constexpr auto table = []<size_t... Shape>(index_sequence<Shape...>) {
+		return array<FuncType, sizeof...(Shape)>{
+			[](const SceneType& Scene, StateType& State) {
+				return get<Shape>(Scene).Interact(State);
+			}...
+		};
+	}(make_index_sequence<tuple_size_v<SceneType>>{});
+
+	assert(Index < table.size());
+	return table[Index](Scene, State);
+}
+
+
+// Lens Connections =======================================
+// Diffuse interactions deposit their reflected color in the
+// trace state. The tracer then connects the interaction to
+// every lens in the scene with a shadow ray, exposing the
+// film directly instead of waiting for a reflected photon
+// to find the lens by chance.
+
+
+// Shadow Ray
+// Traced through the scene like a photon, without interacting.
+struct ShadowRay {
+	RVector	Position;				// Origin of the ray.
+	RVector	Direction;				// Direction of the ray.
+	Real	_HitDist;				// Distance to the nearest intersection.
+	uint32	_HitShape = NoShape;	// Scene index of the nearest intersected shape.
+	uint32	_HitPrim  = 0;			// Primitive within the nearest shape.
+
+	inline void Hit(const Real Distance) {
+		_HitDist = Distance;
+	}
+};
+
+// Detect any shape between a point and a distance along a direction.
+// Returns true if one is found.
+template <typename SceneType>
+inline bool Occluded(const SceneType& Scene, const RVector& Position, const RVector& Direction, const Real Distance) {
+	ShadowRay ray{Position, Direction, Distance};
+	HitScene(Scene, ray);
+	return ray._HitShape != NoShape;
+}
+
+// Connect the state's deposited interaction, if any, to each lens.
+template <typename SceneType, typename StateType>
+inline void ConnectLens(const SceneType& Scene, StateType& State) {
+	if (!State._Connect)
+		return;
+
+	State._Connect = false;
+	ForEachShape(Scene, [&](const auto& Shape, const uint32) {
+		if constexpr (requires { Shape.Connect(Scene, State); })
+			Shape.Connect(Scene, State);
+	});
+}
+
+
+// Bounding Volume Hierarchy ==============================
+// Shapes with finite extent declare a constexpr Bounds box.
+// A hierarchy of boxes over the bounded shapes of a scene
+// is built at compile time from the scene's type alone, by
+// recursively splitting the shapes at the median centroid
+// along the widest axis. Unbounded shapes, such as planes,
+// are tested separately on every trace.
+
+
+// Axis-Aligned Bounding Box
+struct BoundingBox {
+	RVector	Min = Infinity;
+	RVector	Max = -Infinity;
+
+	// Return the smallest box enclosing both boxes.
+	[[nodiscard]] constexpr BoundingBox Union(const BoundingBox& Other) const {
+		return {Min.Min4(RVector(Other.Min)), Max.Max4(RVector(Other.Max))};
+	}
+
+	// Return the center of the box.
+	[[nodiscard]] constexpr RVector Center() const {
+		return (Min + Max) / 2r;
+	}
+
+	// Return the reciprocal of a ray's direction, for Hit. Zero components give the largest
+	// finite values rather than infinities, so that a ray parallel to a slab and starting on
+	// its plane finds a distance of zero rather than NaN (0 * inf), and is not culled.
+	[[nodiscard]] static RVector Reciprocal(const RVector& Direction) {
+		constexpr auto Largest = numeric_limits<Real>::max();
+		return (RVector(1r) / Direction).Clamp4(-Largest, Largest);
+	}
+
+	// Detect an intersection with the box nearer than the supplied distance.
+	// InvDir holds the reciprocal of the ray's direction, from Reciprocal.
+	[[nodiscard]] inline bool Hit(const RVector& Origin, const RVector& InvDir, const Real Distance) const {
+		const auto t1 = (Min - Origin) * InvDir;
+		const auto t2 = (Max - Origin) * InvDir;
+
+		const auto near = max(max(min(t1.x, t2.x), min(t1.y, t2.y)), min(t1.z, t2.z));
+		const auto far  = min(min(max(t1.x, t2.x), max(t1.y, t2.y)), max(t1.z, t2.z));
+		return near <= far && far >= 0r && near < Distance;
+	}
+};
+
+// Shapes with a finite, compile-time bounding box.
+template <typename ShapeType>
+concept BoundedShape = requires { { ShapeType::Bounds } -> convertible_to<BoundingBox>; };
+
+template <typename SceneType>
+class SceneBVH {
+	static constexpr uint32 Shapes   = uint32(tuple_size_v<SceneType>);
+	static constexpr uint32 LeafSize = 2;		// Maximum shapes per leaf.
+
+	// Return the component of the vector along the axis.
+	static constexpr Real Component(const RVector& Vector, const uint32 Axis) {
+		return Axis == 0 ? Vector.x : Axis == 1 ? Vector.y : Vector.z;
+	}
+
+	// Bounding box of every shape, by scene index. Unbounded shapes have empty boxes.
+	static constexpr auto Boxes = []<size_t... Shape>(index_sequence<Shape...>) {
+		const auto box = []<typename ShapeType>(const ShapeType*) {
+			if constexpr (BoundedShape<ShapeType>)
+				return BoundingBox(ShapeType::Bounds);
+			else
+				return BoundingBox{};
+		};
+		return array<BoundingBox, Shapes>{box((tuple_element_t<Shape, SceneType>*)nullptr)...};
+	}(make_index_sequence<Shapes>{});
+
+	// Number of bounded shapes in the scene.
+	static constexpr uint32 Count = []<size_t... Shape>(index_sequence<Shape...>) {
+		return (uint32(BoundedShape<tuple_element_t<Shape, SceneType>>) + ... + 0u);
+	}(make_index_sequence<Shapes>{});
+
+public:
+	// Node of the hierarchy, stored in depth-first order.
+	// An interior node's first child immediately follows it.
+	struct Node {
+		BoundingBox	Box;			// Bounds of every shape beneath the node.
+		uint32		Index = 0;		// Interior: second child. Leaf: first item.
+		uint32		Items = 0;		// Leaf: number of items. Interior: zero.
+	};
+
+	// Scene indices of the shapes tested on every trace.
+	static constexpr auto Unbounded = []<size_t... Shape>(index_sequence<Shape...>) {
+		array<uint32, Shapes - Count> indices{};
+		uint32 next = 0;
+		((BoundedShape<tuple_element_t<Shape, SceneType>> ? void() : void(indices[next++] = Shape)), ...);
+		return indices;
+	}(make_index_sequence<Shapes>{});
+
+	// The hierarchy, with leaf items referring to scene indices.
+	struct Hierarchy {
+		array<Node, max(Count * 2, 1u)>	Nodes{};
+		array<uint32, Count>			Items{};
+		uint32							Depth = 0;
+		uint32							_Used = 0;
+	};
+
+protected:
+	// Build the subtree over a range of items. Returns the node's index.
+	static constexpr uint32 Build(Hierarchy& Tree, const uint32 Begin, const uint32 End, const uint32 Depth) {
+		const auto node = Tree._Used++;
+		Tree.Depth = max(Tree.Depth, Depth);
+
+		// Bound the items and their centers.
+		BoundingBox box, centers;
+		for (auto item = Begin; item < End; item++) {
+			const auto& bounds = Boxes[Tree.Items[item]];
+			box     = box.Union(bounds);
+			centers = centers.Union({bounds.Center(), bounds.Center()});
+		}
+
+		Tree.Nodes[node].Box = box;
+		if (End - Begin <= LeafSize) {
+			Tree.Nodes[node].Index = Begin;
+			Tree.Nodes[node].Items = End - Begin;
+			return node;
+		}
+
+		// Split at the median center along the widest axis.
+		const auto extent = centers.Max - centers.Min;
+		const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0u : extent.y >= extent.z ? 1u : 2u;
+		const auto mid  = (Begin + End) / 2;
+		sort(Tree.Items.begin() + Begin, Tree.Items.begin() + End, [axis](const uint32 A, const uint32 B) {
+			return Component(Boxes[A].Center(), axis) < Component(Boxes[B].Center(), axis);
+		});
+
+		Build(Tree, Begin, mid, Depth + 1);
+		Tree.Nodes[node].Index = Build(Tree, mid, End, Depth + 1);
+		return node;
+	}
+
+public:
+	// Hierarchy over the scene's bounded shapes.
+	static constexpr Hierarchy Tree = []<size_t... Shape>(index_sequence<Shape...>) {
+		Hierarchy tree;
+
+		uint32 next = 0;
+		((BoundedShape<tuple_element_t<Shape, SceneType>> ? void(tree.Items[next++] = Shape) : void()), ...);
+
+		if constexpr (Count > 0)
+			Build(tree, 0, Count, 1);
+
+		return tree;
+	}(make_index_sequence<Shapes>{});
+
+	// Is the hierarchy worth traversing? Small scenes are tested linearly.
+	static constexpr bool Enabled = Count >= 8;
+};
+
+// Find the nearest intersection with any shape in the scene.
+// Records the scene index of the nearest shape in the state.
+template <typename SceneType, typename StateType>
+inline void HitScene(const SceneType& Scene, StateType& State) {
+	using BVH = SceneBVH<SceneType>;
+
+	// Small scenes test every shape.
+	if constexpr (!BVH::Enabled) {
+		ForEachShape(Scene, [&State](const auto& Shape, const uint32 Index) {
+			if (Shape.HitExterior(State))
+				State._HitShape = Index;
+		});
+		return;
+	} else {
+		// Test the unbounded shapes.
+		for (const auto shape : BVH::Unbounded)
+			if (HitExterior(Scene, shape, State))
+				State._HitShape = shape;
+
+		// Walk the hierarchy, skipping boxes beyond the nearest intersection.
+		const auto invDir = BoundingBox::Reciprocal(State.Direction);
+		const auto& tree = BVH::Tree;
+
+		array<uint32, BVH::Tree.Depth> stack;
+		uint32 depth = 0;
+		for (uint32 node = 0;;) {
+			const auto& n = tree.Nodes[node];
+			if (n.Box.Hit(State.Position, invDir, State._HitDist)) {
+				if (!n.Items) {
+					// Descend into the first child, deferring the second.
+					stack[depth++] = n.Index;
+					node++;
+					continue;
+				}
+
+				for (auto item = n.Index; item < n.Index + n.Items; item++)
+					if (HitExterior(Scene, tree.Items[item], State))
+						State._HitShape = tree.Items[item];
+			}
+
+			if (!depth)
+				break;
+
+			node = stack[--depth];
+		}
+	}
+}
\ No newline at end of file
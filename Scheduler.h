@@ -0,0 +1,195 @@
+#pragma once
+
+
+// Work-Stealing Photon Scheduler =========================
+// Photons are handed out in chunks: contiguous ranges of
+// photon indices emitted by a single light source. Each
+// worker owns a deque of ranges, initially seeded with an
+// even share of every light's photons. A worker carves
+// chunks from the back of its own deque. When it runs dry
+// it steals half of the front range from the worker with
+// the most remaining photons. Chunk sizes shrink as the
+// local share shrinks, so the end of a run is balanced
+// finely across fast and slow cores alike.
+
+
+// A range of photons emitted by a single light source.
+struct PhotonChunk {
+	uint32	Light;		// Index of the light in the lights tuple.
+	uint64	Begin;		// First photon index (inclusive).
+	uint64	End;		// Last photon index (exclusive).
+
+	[[nodiscard]] inline uint64 Size() const {
+		return End - Begin;
+	}
+};
+
+class PhotonScheduler {
+	// Per-worker work queue, isolated on its own cache lines.
+	struct alignas(CacheLine) WorkQueue {
+		mutex				Lock;			// Guards the chunk deque.
+		deque<PhotonChunk>	Chunks;			// Pending photon ranges.
+		atomic_uint64_t		Pending = 0;	// Photons remaining in this queue.
+		double				Idle = 0;		// Seconds spent searching for work.
+		timestamp			Finished;		// Time this worker ran out of work.
+	};
+
+	vector<WorkQueue>	_Queues;			// One queue per worker.
+	atomic_uint64_t		_Remaining = 0;		// Photons not yet handed out.
+	atomic_bool			_Stopped = false;	// Stop handing out work.
+
+public:
+	uint64	MinChunk = 1ull << 10;			// Smallest chunk handed out.
+	uint64	MaxChunk = 1ull << 18;			// Largest chunk handed out.
+	uint64	Divisor  = 8;					// Chunk = local photons / Divisor.
+
+	// Evenly distribute the photons of each light across the workers.
+	// Photons holds the number of photons to emit from each light.
+	// Photon indices begin at the supplied sequence number.
+	PhotonScheduler(const size_t Workers, const vector<uint64>& Photons, const uint64 Sequence = 0) :
+		_Queues(Workers) {
+		assert(Workers);
+
+		for (uint32 light = 0; light < Photons.size(); light++)
+			for (size_t worker = 0; worker < Workers; worker++) {
+				const auto share = Photons[light] / Workers;
+				const auto extra = Photons[light] % Workers;
+				const auto begin = Sequence + share * worker + min<uint64>(worker, extra);
+				const auto end   = begin + share + (worker < extra);
+				if (begin == end)
+					continue;
+
+				auto& queue = _Queues[worker];
+				queue.Chunks.push_back({light, begin, end});
+				queue.Pending += end - begin;
+				_Remaining    += end - begin;
+			}
+	}
+
+	// Stop handing out work. Chunks in flight are unaffected.
+	inline void Stop() {
+		_Stopped = true;
+	}
+
+	// Has work stopped being handed out?
+	[[nodiscard]] inline bool Stopped() const {
+		return _Stopped;
+	}
+
+	// Withdraw a worker which will not ask for work, as though it
+	// had run out now. Its photons remain for others to steal.
+	inline void Leave(const size_t Worker) {
+		_Queues[Worker].Finished = Now();
+	}
+
+	// Return the number of photons not yet handed out.
+	[[nodiscard]] inline uint64 Remaining() const {
+		return _Remaining;
+	}
+
+	// Return the seconds the worker spent without work to do.
+	// This includes time spent stealing and time spent waiting
+	// for the slowest worker to finish. Valid once all workers
+	// have run out of work.
+	[[nodiscard]] double Idle(const size_t Worker) const {
+		const auto last = max_element(_Queues.begin(), _Queues.end(),
+			[](const auto& A, const auto& B) { return A.Finished < B.Finished; })->Finished;
+
+		const auto& queue = _Queues[Worker];
+		return queue.Idle + chrono::duration<double>(last - queue.Finished).count();
+	}
+
+	// Obtain the next chunk of photons for the worker.
+	// Returns false when no work remains.
+	bool Next(const size_t Worker, PhotonChunk& Chunk) {
+		auto& queue = _Queues[Worker];
+
+		// Take a chunk from the back of this worker's queue.
+		if (Take(queue, Chunk))
+			return true;
+
+		// Out of local work. Steal until work is found or none remains.
+		const auto start = Now();
+		for (; !_Stopped && _Remaining; this_thread::yield())
+			if (Steal(Worker) && Take(queue, Chunk)) {
+				queue.Idle += Elapsed(start);
+				return true;
+			}
+
+		queue.Idle += Elapsed(start);
+		queue.Finished = Now();
+		return false;
+	}
+
+protected:
+	// Carve an adaptively sized chunk from the back of the queue.
+	// Returns true if a chunk was taken.
+	bool Take(WorkQueue& Queue, PhotonChunk& Chunk) {
+		if (_Stopped)
+			return false;
+
+		auto sync = lock_guard<mutex>(Queue.Lock);
+		if (Queue.Chunks.empty())
+			return false;
+
+		// Size the chunk relative to the work remaining locally.
+		auto& back = Queue.Chunks.back();
+		const auto size = clamp(Queue.Pending / Divisor, MinChunk, MaxChunk);
+
+		// Take the whole range when it is nearly exhausted.
+		if (back.Size() <= size + MinChunk) {
+			Chunk = back;
+			Queue.Chunks.pop_back();
+		} else {
+			Chunk = {back.Light, back.End - size, back.End};
+			back.End = Chunk.Begin;
+		}
+
+		Queue.Pending -= Chunk.Size();
+		_Remaining    -= Chunk.Size();
+		return true;
+	}
+
+	// Steal half of the front range of the busiest worker.
+	// Returns true if any work was stolen.
+	bool Steal(const size_t Thief) {
+		// Select the victim with the most photons pending.
+		size_t victim = Thief;
+		uint64 most   = 0;
+		for (size_t worker = 0; worker < _Queues.size(); worker++)
+			if (const uint64 pending = _Queues[worker].Pending; pending > most) {
+				most   = pending;
+				victim = worker;
+			}
+
+		if (victim == Thief)
+			return false;
+
+		// Split the victim's front range.
+		PhotonChunk stolen;
+		{
+			auto& queue = _Queues[victim];
+			auto sync = lock_guard<mutex>(queue.Lock);
+			if (queue.Chunks.empty())
+				return false;
+
+			auto& front = queue.Chunks.front();
+			if (front.Size() < MinChunk * 2) {
+				stolen = front;
+				queue.Chunks.pop_front();
+			} else {
+				stolen = {front.Light, front.Begin, front.Begin + front.Size() / 2};
+				front.Begin = stolen.End;
+			}
+
+			queue.Pending -= stolen.Size();
+		}
+
+		// Deposit the stolen range in the thief's queue.
+		auto& queue = _Queues[Thief];
+		auto sync = lock_guard<mutex>(queue.Lock);
+		queue.Chunks.push_back(stolen);
+		queue.Pending += stolen.Size();
+		return true;
+	}
+};
\ No newline at end of file
@@ -6,31 +6,57 @@
 
 template <RVector Position, Real Radius, typename Material>
 struct Sphere {
+	using MaterialType = Material;
+
 	static constexpr RVector _InvRad = 1r / Radius;
 	static constexpr Real	 _RadSq  = Radius * Radius;
 
+	static constexpr BoundingBox Bounds{Position - Radius, Position + Radius};
+
 	// Detect an intersection with the exterior of the sphere.
+	// Returns true if it is the nearest intersection so far.
 	template <typename StateType>
-	void HitExterior(StateType& State) const {
+	bool HitExterior(StateType& State) const {
 		const auto dlt = Position - State.Position;
 		const auto adj = dlt.Dot(State.Direction);
 		if (adj < Epsilon)
-			return;
+			return false;
 
 		const auto oppSq = dlt.LengthSq() - adj * adj;
 		if (oppSq >= _RadSq)
-			return;
+			return false;
 
 		const auto dist = adj - sqrt(_RadSq - oppSq);
 		if (dist >= State._HitDist)
-			return;
+			return false;
+
+		State.Hit(dist);
+		return true;
+	}
 
-		State.Hit(dist, [=, &State]() -> bool {
-			State.Position += State.Direction * State._HitDist;
-			return Material::Interface(State, *this);
+	// Detect intersections of a batch of photons with the exterior of the sphere.
+	template <typename BatchType>
+	void HitBatch(BatchType& Batch, const uint32 Index) const {
+		HitLanes(Batch, Index, [](const auto PX, const auto PY, const auto PZ,
+								  const auto DX, const auto DY, const auto DZ) {
+			const auto dx  = Position.x - PX;
+			const auto dy  = Position.y - PY;
+			const auto dz  = Position.z - PZ;
+			const auto adj = dx * DX + dy * DY + dz * DZ;
+
+			const auto oppSq = dx * dx + dy * dy + dz * dz - adj * adj;
+			const auto dist  = adj - Sqrt(Max(_RadSq - oppSq, 0r));
+			return pair{dist, (adj >= Epsilon) & (oppSq < _RadSq)};
 		});
 	}
 
+	// Move the photon to the intersection and apply the material.
+	template <typename StateType>
+	inline bool Interact(StateType& State) const {
+		State.Position += State.Direction * State._HitDist;
+		return Material::Interface(State, *this);
+	}
+
 	// Compute the surface normal at the hit position.
 	template <typename StateType>
 	inline void HitNormal(StateType& State) const {
@@ -40,23 +66,44 @@ struct Sphere {
 
 template <RVector Position, RVector Normal, typename Material>
 struct Plane {
+	using MaterialType = Material;
+
 	// Detect an intersection with the exterior of the plane.
+	// Returns true if it is the nearest intersection so far.
 	template <typename StateType>
-	void HitExterior(StateType& State) const {
+	bool HitExterior(StateType& State) const {
 		auto dist = Normal.Dot(State.Direction);
 		if (dist > -Epsilon)
-			return;
+			return false;
 
 		dist = Normal.Dot(Position - State.Position) / dist;
 		if (dist >= State._HitDist || dist < Epsilon)
-			return;
+			return false;
+
+		State.Hit(dist);
+		return true;
+	}
 
-		State.Hit(dist, [=, &State]() -> bool {
-			State.Position += State.Direction * State._HitDist;
-			return Material::Interface(State, *this);
+	// Detect intersections of a batch of photons with the exterior of the plane.
+	template <typename BatchType>
+	void HitBatch(BatchType& Batch, const uint32 Index) const {
+		HitLanes(Batch, Index, [](const auto PX, const auto PY, const auto PZ,
+								  const auto DX, const auto DY, const auto DZ) {
+			const auto den  = Normal.x * DX + Normal.y * DY + Normal.z * DZ;
+			const auto dist = (Normal.x * (Position.x - PX) +
+							   Normal.y * (Position.y - PY) +
+							   Normal.z * (Position.z - PZ)) / den;
+			return pair{dist, (den <= -Epsilon) & (dist >= Epsilon)};
 		});
 	}
 
+	// Move the photon to the intersection and apply the material.
+	template <typename StateType>
+	inline bool Interact(StateType& State) const {
+		State.Position += State.Direction * State._HitDist;
+		return Material::Interface(State, *this);
+	}
+
 	// Return the surface normal.
 	template <typename StateType>
 	inline void HitNormal(StateType& State) const {
@@ -0,0 +1,312 @@
+#pragma once
+
+
+// SIMD Lanes =============================================
+// Thin wrappers over AVX2 (8 x Real) and AVX-512 (16 x Real)
+// registers, with the same operators and helpers as a plain
+// Real. Kernels written once against these types run on 1,
+// 8, or 16 photons at a time. The widest lanes supported by
+// the CPU are selected at runtime.
+
+
+// CPU Feature Detection
+struct CpuFeatures {
+	bool	AVX2   = false;		// AVX2 and FMA, with OS support for YMM state.
+	bool	AVX512 = false;		// AVX-512 F/CD/BW, with OS support for ZMM state.
+
+	CpuFeatures() {
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return;
+
+		__cpuidex(info, 1, 0);
+		const bool fma     = info[2] & (1 << 12);
+		const bool osxsave = info[2] & (1 << 27);
+		if (!osxsave)
+			return;
+
+		// Check that the OS saves the vector registers across context switches.
+		const auto xcr0 = _xgetbv(0);
+		const bool ymm  = (xcr0 & 0x06) == 0x06;
+		const bool zmm  = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		AVX2   = ymm && fma && (info[1] & (1 << 5));
+		AVX512 = zmm && AVX2 && (info[1] & (1 << 16)) && (info[1] & (1 << 28)) && (info[1] & (1 << 30));
+	}
+};
+
+// Features of the CPU this process is running on.
+inline const CpuFeatures CPU;
+
+
+// 8 x Real Lanes (AVX2) ==================================
+
+
+struct Mask8 {
+	__m256	v;
+
+	inline friend Mask8 operator& (const Mask8 A, const Mask8 B) { return {_mm256_and_ps(A.v, B.v)}; }
+	inline friend Mask8 operator| (const Mask8 A, const Mask8 B) { return {_mm256_or_ps (A.v, B.v)}; }
+
+	// Return a bitmask with one bit per lane.
+	[[nodiscard]] inline uint32 Bits() const { return uint32(_mm256_movemask_ps(v)); }
+};
+
+// 32-bit integer words, unpacked from records into lanes.
+struct Word8 {
+	__m256i	v;
+
+	// Gather one word from each of 8 records, Stride bytes apart.
+	[[nodiscard]] inline static Word8 Gather(const void* Base, const uint32 Stride) {
+		const auto offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(int(Stride)));
+		return {_mm256_i32gather_epi32((const int*)Base, offsets, 1)};
+	}
+};
+
+struct Real8 {
+	static constexpr uint32 Width = 8;
+	using WordType = Word8;
+
+	__m256	v;
+
+	Real8() = default;
+	inline Real8(const __m256 V) : v(V) {}
+	inline Real8(const Real Scalar) : v(_mm256_set1_ps(Scalar)) {}
+
+	[[nodiscard]] inline static Real8 Load(const Real* Source) { return _mm256_load_ps(Source); }
+	[[nodiscard]] inline static Real8 LoadUnaligned(const Real* Source) { return _mm256_loadu_ps(Source); }
+
+	inline friend Real8 operator+ (const Real8 A, const Real8 B) { return _mm256_add_ps(A.v, B.v); }
+	inline friend Real8 operator- (const Real8 A, const Real8 B) { return _mm256_sub_ps(A.v, B.v); }
+	inline friend Real8 operator* (const Real8 A, const Real8 B) { return _mm256_mul_ps(A.v, B.v); }
+	inline friend Real8 operator/ (const Real8 A, const Real8 B) { return _mm256_div_ps(A.v, B.v); }
+
+	inline friend Mask8 operator<  (const Real8 A, const Real8 B) { return {_mm256_cmp_ps(A.v, B.v, _CMP_LT_OQ)}; }
+	inline friend Mask8 operator<= (const Real8 A, const Real8 B) { return {_mm256_cmp_ps(A.v, B.v, _CMP_LE_OQ)}; }
+	inline friend Mask8 operator>  (const Real8 A, const Real8 B) { return {_mm256_cmp_ps(A.v, B.v, _CMP_GT_OQ)}; }
+	inline friend Mask8 operator>= (const Real8 A, const Real8 B) { return {_mm256_cmp_ps(A.v, B.v, _CMP_GE_OQ)}; }
+};
+
+inline Real8 Sqrt(const Real8 A)					{ return _mm256_sqrt_ps(A.v); }
+inline Real8 Max (const Real8 A, const Real8 B)		{ return _mm256_max_ps(A.v, B.v); }
+inline Real8 Min (const Real8 A, const Real8 B)		{ return _mm256_min_ps(A.v, B.v); }
+inline Real8 Trunc(const Real8 A)					{ return _mm256_round_ps(A.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+// Select lanes of A where the mask is set, and of B elsewhere.
+inline Real8 Select(const Mask8 Mask, const Real8 A, const Real8 B) {
+	return _mm256_blendv_ps(B.v, A.v, Mask.v);
+}
+
+// Return 2 raised to integral exponents, within +/-252.
+inline Real8 Exp2(const Real8 Exponent) {
+	const auto e    = _mm256_cvtps_epi32(Exponent.v);
+	const auto half = _mm256_srai_epi32(e, 1);
+	const auto bias = _mm256_set1_epi32(127);
+	const auto a = _mm256_slli_epi32(_mm256_add_epi32(half, bias), 23);
+	const auto b = _mm256_slli_epi32(_mm256_add_epi32(_mm256_sub_epi32(e, half), bias), 23);
+	return _mm256_mul_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b));
+}
+
+// Unpack the signed low and high halves, or an unsigned byte, of each word.
+inline Word8 Low16 (const Word8 W)						{ return {_mm256_srai_epi32(_mm256_slli_epi32(W.v, 16), 16)}; }
+inline Word8 High16(const Word8 W)						{ return {_mm256_srai_epi32(W.v, 16)}; }
+inline Word8 Byte  (const Word8 W, const uint32 Index)	{ return {_mm256_and_si256(_mm256_srli_epi32(W.v, int(Index * 8)), _mm256_set1_epi32(0xFF))}; }
+inline Real8 ToReal(const Word8 W)						{ return _mm256_cvtepi32_ps(W.v); }
+
+// Store all lanes.
+inline void Store(Real* Target, const Real8 Value) {
+	_mm256_store_ps(Target, Value.v);
+}
+
+// Store the lanes selected by the mask.
+inline void Store(const Mask8 Mask, Real* Target, const Real8 Value) {
+	_mm256_maskstore_ps(Target, _mm256_castps_si256(Mask.v), Value.v);
+}
+
+inline void Store(const Mask8 Mask, uint32* Target, const uint32 Value) {
+	_mm256_maskstore_epi32((int*)Target, _mm256_castps_si256(Mask.v), _mm256_set1_epi32(int(Value)));
+}
+
+
+// 16 x Real Lanes (AVX-512) ==============================
+
+
+struct Mask16 {
+	__mmask16	v;
+
+	inline friend Mask16 operator& (const Mask16 A, const Mask16 B) { return {__mmask16(A.v & B.v)}; }
+	inline friend Mask16 operator| (const Mask16 A, const Mask16 B) { return {__mmask16(A.v | B.v)}; }
+
+	// Return a bitmask with one bit per lane.
+	[[nodiscard]] inline uint32 Bits() const { return uint32(v); }
+};
+
+// 32-bit integer words, unpacked from records into lanes.
+struct Word16 {
+	__m512i	v;
+
+	// Gather one word from each of 16 records, Stride bytes apart.
+	[[nodiscard]] inline static Word16 Gather(const void* Base, const uint32 Stride) {
+		const auto offsets = _mm512_mullo_epi32(
+			_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(int(Stride)));
+		return {_mm512_i32gather_epi32(offsets, Base, 1)};
+	}
+};
+
+struct Real16 {
+	static constexpr uint32 Width = 16;
+	using WordType = Word16;
+
+	__m512	v;
+
+	Real16() = default;
+	inline Real16(const __m512 V) : v(V) {}
+	inline Real16(const Real Scalar) : v(_mm512_set1_ps(Scalar)) {}
+
+	[[nodiscard]] inline static Real16 Load(const Real* Source) { return _mm512_load_ps(Source); }
+	[[nodiscard]] inline static Real16 LoadUnaligned(const Real* Source) { return _mm512_loadu_ps(Source); }
+
+	inline friend Real16 operator+ (const Real16 A, const Real16 B) { return _mm512_add_ps(A.v, B.v); }
+	inline friend Real16 operator- (const Real16 A, const Real16 B) { return _mm512_sub_ps(A.v, B.v); }
+	inline friend Real16 operator* (const Real16 A, const Real16 B) { return _mm512_mul_ps(A.v, B.v); }
+	inline friend Real16 operator/ (const Real16 A, const Real16 B) { return _mm512_div_ps(A.v, B.v); }
+
+	inline friend Mask16 operator<  (const Real16 A, const Real16 B) { return {_mm512_cmp_ps_mask(A.v, B.v, _CMP_LT_OQ)}; }
+	inline friend Mask16 operator<= (const Real16 A, const Real16 B) { return {_mm512_cmp_ps_mask(A.v, B.v, _CMP_LE_OQ)}; }
+	inline friend Mask16 operator>  (const Real16 A, const Real16 B) { return {_mm512_cmp_ps_mask(A.v, B.v, _CMP_GT_OQ)}; }
+	inline friend Mask16 operator>= (const Real16 A, const Real16 B) { return {_mm512_cmp_ps_mask(A.v, B.v, _CMP_GE_OQ)}; }
+};
+
+inline Real16 Sqrt(const Real16 A)					{ return _mm512_sqrt_ps(A.v); }
+inline Real16 Max (const Real16 A, const Real16 B)	{ return _mm512_max_ps(A.v, B.v); }
+inline Real16 Min (const Real16 A, const Real16 B)	{ return _mm512_min_ps(A.v, B.v); }
+inline Real16 Trunc(const Real16 A)				{ return _mm512_roundscale_ps(A.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+
+// Select lanes of A where the mask is set, and of B elsewhere.
+inline Real16 Select(const Mask16 Mask, const Real16 A, const Real16 B) {
+	return _mm512_mask_blend_ps(Mask.v, B.v, A.v);
+}
+
+// Return 2 raised to integral exponents, within +/-252.
+inline Real16 Exp2(const Real16 Exponent) {
+	const auto e    = _mm512_cvtps_epi32(Exponent.v);
+	const auto half = _mm512_srai_epi32(e, 1);
+	const auto bias = _mm512_set1_epi32(127);
+	const auto a = _mm512_slli_epi32(_mm512_add_epi32(half, bias), 23);
+	const auto b = _mm512_slli_epi32(_mm512_add_epi32(_mm512_sub_epi32(e, half), bias), 23);
+	return _mm512_mul_ps(_mm512_castsi512_ps(a), _mm512_castsi512_ps(b));
+}
+
+// Unpack the signed low and high halves, or an unsigned byte, of each word.
+inline Word16 Low16 (const Word16 W)						{ return {_mm512_srai_epi32(_mm512_slli_epi32(W.v, 16), 16)}; }
+inline Word16 High16(const Word16 W)						{ return {_mm512_srai_epi32(W.v, 16)}; }
+inline Word16 Byte  (const Word16 W, const uint32 Index)	{ return {_mm512_and_si512(_mm512_srli_epi32(W.v, Index * 8), _mm512_set1_epi32(0xFF))}; }
+inline Real16 ToReal(const Word16 W)						{ return _mm512_cvtepi32_ps(W.v); }
+
+// Store all lanes.
+inline void Store(Real* Target, const Real16 Value) {
+	_mm512_store_ps(Target, Value.v);
+}
+
+// Store the lanes selected by the mask.
+inline void Store(const Mask16 Mask, Real* Target, const Real16 Value) {
+	_mm512_mask_store_ps(Target, Mask.v, Value.v);
+}
+
+inline void Store(const Mask16 Mask, uint32* Target, const uint32 Value) {
+	_mm512_mask_store_epi32(Target, Mask.v, _mm512_set1_epi32(int(Value)));
+}
+
+
+// 1 x Real Lanes (Scalar Fallback) =======================
+
+
+inline Real Sqrt(const Real A)					{ return sqrt(A); }
+inline Real Max (const Real A, const Real B)	{ return max(A, B); }
+inline Real Min (const Real A, const Real B)	{ return min(A, B); }
+inline Real Trunc(const Real A)					{ return trunc(A); }
+
+inline Real Select(const bool Mask, const Real A, const Real B) {
+	return Mask ? A : B;
+}
+
+inline Real Exp2(const Real Exponent) {
+	return ldexp(1r, int(Exponent));
+}
+
+inline int32 Low16 (const int32 W)						{ return int16(W); }
+inline int32 High16(const int32 W)						{ return int16(uint32(W) >> 16); }
+inline int32 Byte  (const int32 W, const uint32 Index)	{ return (uint32(W) >> (Index * 8)) & 0xFF; }
+inline Real  ToReal(const int32 W)						{ return Real(W); }
+
+inline void Store(Real* Target, const Real Value) {
+	*Target = Value;
+}
+
+template <typename Type>
+inline void Store(const bool Mask, Type* Target, const Type Value) {
+	if (Mask)
+		*Target = Value;
+}
+
+
+// Lane Dispatch ==========================================
+
+
+template <typename LaneType>
+struct Lanes {
+	static constexpr uint32 Width = LaneType::Width;
+
+	[[nodiscard]] inline static LaneType Load(const Real* Source) { return LaneType::Load(Source); }
+	[[nodiscard]] inline static LaneType LoadUnaligned(const Real* Source) { return LaneType::LoadUnaligned(Source); }
+
+	[[nodiscard]] inline static auto Gather(const void* Base, const uint32 Stride) {
+		return LaneType::WordType::Gather(Base, Stride);
+	}
+};
+
+template <>
+struct Lanes<Real> {
+	static constexpr uint32 Width = 1;
+
+	[[nodiscard]] inline static Real Load(const Real* Source) { return *Source; }
+	[[nodiscard]] inline static Real LoadUnaligned(const Real* Source) { return *Source; }
+
+	[[nodiscard]] inline static int32 Gather(const void* Base, uint32) {
+		int32 word;
+		memcpy(&word, Base, sizeof word);
+		return word;
+	}
+};
+
+// Intersect a batch of photons with a shape using lanes of the given type.
+// The kernel receives photon positions and directions, and returns the
+// distance to the intersection along with a mask of valid intersections.
+// The nearest intersections are updated under the mask.
+template <typename LaneType, typename BatchType, typename KernelType>
+inline void HitLanes(BatchType& Batch, const uint32 Index, const KernelType& Kernel) {
+	using L = Lanes<LaneType>;
+
+	for (uint32 i = 0; i < Batch.Count; i += L::Width) {
+		const auto [dist, valid] = Kernel(
+			L::Load(&Batch.PosX[i]), L::Load(&Batch.PosY[i]), L::Load(&Batch.PosZ[i]),
+			L::Load(&Batch.DirX[i]), L::Load(&Batch.DirY[i]), L::Load(&Batch.DirZ[i]));
+
+		const auto hit = valid & (dist < L::Load(&Batch.HitDist[i]));
+		Store(hit, &Batch.HitDist [i], dist);
+		Store(hit, &Batch.HitShape[i], Index);
+	}
+}
+
+// Intersect a batch of photons with a shape using the widest lanes available.
+template <typename BatchType, typename KernelType>
+inline void HitLanes(BatchType& Batch, const uint32 Index, const KernelType& Kernel) {
+	if (CPU.AVX512)
+		HitLanes<Real16>(Batch, Index, Kernel);
+	else if (CPU.AVX2)
+		HitLanes<Real8>(Batch, Index, Kernel);
+	else
+		HitLanes<Real>(Batch, Index, Kernel);
+}
\ No newline at end of file
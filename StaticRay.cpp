@@ -9,6 +9,79 @@ using ColorSystem	= RGBSystem;
 using EmissiveType	= ColorSystem::EmissiveType;
 using MaterialType	= ColorSystem::MaterialType;
 using ColorFilm16	= ColorFilm<HitRecord<Fixed16, ColorSystem>>;
+using PhotonSampler	= PseudoSampler;	// Or quasi-random: SobolSampler, HaltonSampler
+
+// Tracing Engine
+constexpr auto Wavefront = false;		// Trace photons in batches instead of one at a time
+constexpr auto Connect   = true;		// Connect diffuse interactions to the lens (light tracing)
+
+// Development Engine
+constexpr auto SimdLanes = true;		// Develop photons in SIMD lanes instead of one at a time
+
+// Output
+constexpr auto Compress  = true;		// Write photon hit records in compressed blocks
+constexpr auto FrameFormat = ImageFormat::Targa;	// Or linear HDR frames: Pfm, Exr, ExrRle
+constexpr auto FrameVideo  = VideoFormat::Avi;		// Or Y4m, Mjpeg, or None for a file per frame
+constexpr auto FrameRate   = 30u;					// Video frames per second
+
+// Virtual camera configuration, for development
+constexpr auto Zoom		= 1r;
+constexpr auto FocalLen	= 1r;
+constexpr auto FLimit	= 0.8r;
+
+constexpr auto Width	= 256u;
+constexpr auto Height	= 256u;
+
+
+// Default Scene
+// Rendered by default, and traced by the convergence benchmark.
+
+// Camera setup
+constexpr auto LensRadius = 2r;
+constexpr auto CameraPos  = RVector{-2, 4, 2};
+constexpr auto CameraTgt  = RVector{ 2,-4,-2};
+constexpr auto CameraDir  = (CameraTgt - CameraPos).ConstNormalized();
+
+// Material colors
+using RedMaterial   = MaterialColor<ColorSystem, {0.9, 0.3, 0.3}>;
+using BlueMaterial  = MaterialColor<ColorSystem, {0.3, 0.3, 0.9}>;
+using WhiteMaterial = MaterialColor<ColorSystem, {0.9, 0.9, 0.9}>;
+
+// Materials
+using RedPaint   = IdealDiffuse<RedMaterial  >;
+using BluePaint  = IdealDiffuse<BlueMaterial >;
+using WhitePaint = IdealDiffuse<WhiteMaterial>;
+using Mirror     = IdealMirror;
+
+// Light colors
+using WhiteLight = EmissiveColor<ColorSystem, {1.0, 1.0, 1.0}>;
+using GreenLight = EmissiveColor<ColorSystem, {0.0, 1.0, 0.0}>;
+
+// Scene setup
+constexpr tuple DefaultScene {
+	Plane<{ 0, 0,-6}, { 0, 0, 1}, WhitePaint>{},	// Floor
+	Plane<{ 0, 0, 6}, { 0, 0,-1}, WhitePaint>{},	// Ceiling
+	Plane<{ 0,-6, 0}, { 0, 1, 0}, WhitePaint>{},	// North wall
+	Plane<{ 0, 6, 0}, { 0,-1, 0}, WhitePaint>{},	// South wall
+	Plane<{-6, 0, 0}, { 1, 0, 0}, RedPaint  >{},	// West wall
+	Plane<{ 6, 0, 0}, {-1, 0, 0}, BluePaint >{},	// East wall
+
+	Sphere<{-4,-4, 1}, 2r, BluePaint>{},
+	Sphere<{ 4,-4, 1}, 2r, RedPaint >{},
+	Sphere<{ 0, 0,-3}, 3r, Mirror   >{},
+
+	Lens< CameraPos, CameraDir, {0, 0, 1}, LensRadius, 0.8r>{},	// Camera
+};
+
+// Light sources
+constexpr tuple DefaultLights {
+#if !defined(_DEBUG)
+	OmniSphere<{0, 0, 5}, 1r, 1r,	WhiteLight>{},
+	PointLight<{0, 5,-5}, 1r,		GreenLight>{},
+#else
+	PointBeam<{-1.2,5.5,0.8}, {0,-1,0}, 1r, WhiteLight>{},
+#endif
+};
 
 
 // Trace the scene for an intersection.
@@ -17,28 +90,79 @@ template <typename SceneType, typename StateType>
 static bool Trace(const SceneType& Scene, StateType& State) {
 	State.Reset();
 
-	apply([&State](auto&... Shape) { (Shape.HitExterior(State), ...); }, Scene);
+	// Find the nearest intersection, remembering which shape it was.
+	HitScene(Scene, State);
 
-	return State._HitFunc ? State._HitFunc() : false;
+	// Invoke the nearest shape's interface.
+	const auto alive = State._HitShape != NoShape && Interact(Scene, State._HitShape, State);
+
+	// Connect any diffuse interaction to the lens.
+	ConnectLens(Scene, State);
+	return alive;
 }
 
-// Illuminate the scene with each light source.
-// Calls the supplied function for each photon emitted by each light.
+// Call the supplied function on the light source at the supplied index.
 template <typename LightsType, typename LambdaType>
-static void Illuminate(const LightsType& Lights, const Real Multiplier, LambdaType Func) {
-	const auto visitor = [=](const auto& Light) {
-		const auto traces = Light.Traces(Multiplier);
-		for (uint64 trace = 0; trace < traces; trace++)
+static void VisitLight(const LightsType& Lights, uint32 Index, LambdaType Func) {
+	const auto visitor = [&](const auto& Light) {
+		if (!Index--)
 			Func(Light);
 	};
 
-	apply([=](const auto&... Light) { (visitor(Light), ...); }, Lights);
+	apply([&](const auto&... Light) { (visitor(Light), ...); }, Lights);
+}
+
+// Illuminate the scene with a chunk of photons from one light source.
+// Calls the supplied function with the light and each photon's index.
+template <typename LightsType, typename LambdaType>
+static void Illuminate(const LightsType& Lights, const PhotonChunk& Chunk, LambdaType Func) {
+	VisitLight(Lights, Chunk.Light, [&](const auto& Light) {
+		for (auto trace = Chunk.Begin; trace < Chunk.End; trace++)
+			Func(Light, trace);
+	});
 }
 
+// Trace a chunk of photons one at a time.
+template <typename SceneType, typename LightsType, typename StateType>
+static void TraceChunk(const SceneType& Scene, const LightsType& Lights, const PhotonChunk& Chunk,
+	const uint32 Bounces, StateType& State) {
+	// Illuminate the scene...
+	Illuminate(Lights, Chunk, [&](const auto& Light, const uint64 Photon) {
+		// Start tracing by emitting a photon.
+		State.Start(Photon, Chunk.Light);
+		Light.Emit(State);
+
+		// Trace and bounce the photon until...
+		// it bounces too many times, or
+		// no intersections were found, or
+		// the trace electively terminates.
+		uint32 bounce = 0;
+		for (; bounce < Bounces && Trace(Scene, State);
+			State._Hits++, bounce++);
+
+		State.Terminate(bounce);
+	});
+}
+
+// Progressive Rendering Budgets
+// Rendering stops as soon as any budget is exhausted.
+// A budget of zero is disabled.
+struct RenderBudget {
+	float64	Seconds = 0;	// Wall-clock time, in seconds.
+	uint64	Photons = 0;	// Photons emitted by all lights.
+	float64	Noise   = 0;	// Estimated relative noise per pixel.
+};
+
+// Set when the process is asked to terminate.
+static atomic_bool Interrupted = false;
+
 // Render the scene.
 // Light sources emit photons which are transported through the 
 // scene and captured when they pass through the virtual lens.
-void Render(const path& Filename) {
+// Without any budget, the configured number of passes is rendered.
+// When resuming, photons are appended to the file from its last
+// checkpoint and budgeted photons include those already emitted.
+void Render(const path& Filename, const RenderBudget& Budget, const bool Resume, const WorkerPlacement& Placement) {
 #if !defined(_DEBUG)
 	// Snooze a bit to let the system calm down.
 	cout << "Wait..." << endl;
@@ -49,10 +173,10 @@ void Render(const path& Filename) {
 #if !defined(_DEBUG)
 	constexpr auto Multiplier = 1e5r;		// Photons per pass ~= Light.Intensity * Multiplier
 	constexpr auto Passes     = 1000u;		// Total photons ~= Photons per pass * Passes
-	constexpr auto Bounces    = 10u;		// Maximum bounces per photon
+	constexpr auto Bounces    = 64u;		// Safety limit on bounces (Russian roulette ends most traces)
 	constexpr auto Buffer     = 1ull << 16;	// Photons to buffer between writes
 
-	const     auto Threads    = max(thread::hardware_concurrency(), 1u);
+	const     auto Threads    = Placement.Workers();
 #else
 	constexpr auto Multiplier = 1r;
 	constexpr auto Bounces    = 1u;
@@ -62,79 +186,115 @@ void Render(const path& Filename) {
 	constexpr auto Threads    = 1u;
 #endif
 
-	// Camera setup
-	constexpr auto LensRadius = 2r;
-	constexpr auto CameraPos  = RVector{-2, 4, 2};
-	constexpr auto CameraTgt  = RVector{ 2,-4,-2};
-	constexpr auto CameraDir  = (CameraTgt - CameraPos).ConstNormalized();
-
-	// Material colors
-	using RedMaterial   = MaterialColor<ColorSystem, {0.9, 0.3, 0.3}>;
-	using BlueMaterial  = MaterialColor<ColorSystem, {0.3, 0.3, 0.9}>;
-	using WhiteMaterial = MaterialColor<ColorSystem, {0.9, 0.9, 0.9}>;
-
-	// Materials
-	using RedPaint   = IdealDiffuse<RedMaterial  >;
-	using BluePaint  = IdealDiffuse<BlueMaterial >;
-	using WhitePaint = IdealDiffuse<WhiteMaterial>;
-	using Mirror     = IdealMirror;
-
-	// Light colors
-	using WhiteLight = EmissiveColor<ColorSystem, {1.0, 1.0, 1.0}>;
-	using GreenLight = EmissiveColor<ColorSystem, {0.0, 1.0, 0.0}>;
+	// Progressive rendering parameters
+	constexpr auto Unlimited  = 1ull << 48;	// Photons emitted when only time or noise is budgeted
+	constexpr auto Pixels     = 256u * 256u;	// Pixels in the developed image, for noise estimates
+	constexpr auto Interval   = 100ms;		// Time between budget checks
+	constexpr auto Periodic   = 10.0;		// Seconds between checkpoints
 
 	// Scene setup
-	constexpr tuple scene {
-		Plane<{ 0, 0,-6}, { 0, 0, 1}, WhitePaint>{},	// Floor
-		Plane<{ 0, 0, 6}, { 0, 0,-1}, WhitePaint>{},	// Ceiling
-		Plane<{ 0,-6, 0}, { 0, 1, 0}, WhitePaint>{},	// North wall
-		Plane<{ 0, 6, 0}, { 0,-1, 0}, WhitePaint>{},	// South wall
-		Plane<{-6, 0, 0}, { 1, 0, 0}, RedPaint  >{},	// West wall
-		Plane<{ 6, 0, 0}, {-1, 0, 0}, BluePaint >{},	// East wall
-		
-		Sphere<{-4,-4, 1}, 2r, BluePaint>{},
-		Sphere<{ 4,-4, 1}, 2r, RedPaint >{},
-		Sphere<{ 0, 0,-3}, 3r, Mirror   >{},
-	
-		Lens< CameraPos, CameraDir, {0, 0, 1}, LensRadius, 0.8r>{},	// Camera
-	};
+	const auto& scene  = DefaultScene;
+	const auto& lights = DefaultLights;
 
-	// Light sources
-	constexpr tuple lights {
-#if !defined(_DEBUG)
-		OmniSphere<{0, 0, 5}, 1r, 1r,	WhiteLight>{},
-		PointLight<{0, 5,-5}, 1r,		GreenLight>{},
-#else
-		PointBeam<{-1.2,5.5,0.8}, {0,-1,0}, 1r, WhiteLight>{},
-#endif
-	};
+	// Load any meshes in the scene.
+	if (LoadScene(scene)) {
+		cout << "Unable to load the scene." << endl;
+		return;
+	}
+
+	// Count the photons emitted by each light per pass.
+	vector<uint64> photons;
+	apply([&](const auto&... Light) {
+		(photons.push_back(Light.Traces(Multiplier)), ...);
+	}, lights);
 
-	// Current pass number, synchronized.
-	atomic_uint32_t pass = 0;
+	uint64 perPass = 0;
+	for (const auto count : photons)
+		perPass += count;
 
-	// Create the output file.
+	// Create the output file, or reopen it at its last checkpoint.
 	DataStream data;
+	Checkpoint checkpoint;
 	const auto filename = path("out/") / Filename;
-	if (data.New(filename))
+	if (Resume) {
+		if (data.Append(filename) || checkpoint.ReadLast(data) || data.SeekTail()) {
+			cout << "No checkpoint to resume from." << endl;
+			return;
+		}
+	} else if (data.New(filename))
 		return;
 
-	// Prepare tracer states for each thread.
-	using StateType = TraceState<EmissiveType, ColorFilm16>;
-	vector<StateType> states(Threads);
-	for (auto& state : states) {
-		// Seed each thread's RNG with a unique sequence.
-		static Random seed;
-		seed.LongJump();
-
-		// Initialize the tracing state.
-		state = { {&data, Buffer}, seed };
-		state.Film.Config = { LensRadius };
-	}
+	// Scale the passes to the photon budget, less any photons already emitted.
+	const auto previous = checkpoint.Header.Photons;
+	const auto budget = Budget.Photons ? Budget.Photons :
+		Budget.Seconds || Budget.Noise ? Unlimited + previous : perPass * Passes;
+	const auto total = budget - min(budget, previous);
+	for (auto& count : photons)
+		count = uint64(float64(count) * total / perPass);
+
+	// Divide the photons among the workers.
+	// Photon indices continue from the previous session.
+	const auto sequence = checkpoint.Header.Sequence;
+	PhotonScheduler scheduler(Threads, photons, sequence);
+
+	// Seed each of the threads' RNG streams with a unique sequence. Resumed
+	// streams jump past anything drawn since their state was checkpointed,
+	// including by a session that was killed before it could finish. A new render
+	// draws its quasi-random scramble seed first; a resumed one keeps the stored seed.
+	vector<array<Random, RandomStreams::Streams>> seeds(Threads);
+	auto& seed = checkpoint.Header.Seed;
+	if (!Resume)
+		checkpoint.Header.Scramble = uint32(seed());
+	for (unsigned worker = 0; worker < Threads; worker++)
+		for (uint32 stream = 0; stream < RandomStreams::Streams; stream++) {
+			const auto index = worker * RandomStreams::Streams + stream;
+			auto& rng = seeds[worker][stream];
+			if (index < checkpoint.size()) {
+				rng = checkpoint[index];
+				rng.ShortJump();
+			} else {
+				seed.LongJump();
+				rng = seed;
+			}
+		}
+
+	// Tracer states for each thread, allocated by the threads themselves.
+	using StateType = TraceState<EmissiveType, ColorFilm16, PhotonSampler>;
+	vector<NodeLocal<StateType>> states(Threads);
+	vector<FilmPreview> previews(Threads);
+	vector<atomic_uint64_t> flushed(Threads);
 
 	// Write the film configuration.
-	if (states[0].Film.WriteConfig())
+	ColorFilm16 config{&data, 1};
+	config.Config = { LensRadius };
+	if (!Resume && config.WriteConfig())
 		return;
+
+	// Record a checkpoint before any photons are written, holding the streams this
+	// session draws from and the photon indices it claims, so a session resumed after
+	// this one is killed neither repeats its streams nor reuses its photon indices.
+	checkpoint.Header.Sequence = sequence + *max_element(photons.begin(), photons.end());
+	checkpoint.resize(0);
+	for (unsigned worker = 0; worker < Threads; worker++)
+		checkpoint.insert(checkpoint.end(), seeds[worker].begin(), seeds[worker].end());
+
+	if (checkpoint.Write(data)) {
+		cout << "Failed to write checkpoint." << endl;
+		return;
+	}
+
+	// Workers append their film blocks at reserved offsets, without the stream lock.
+	if (data.BeginAppend()) {
+		cout << "Failed to open the output file for appending." << endl;
+		return;
+	}
 	
+	cout << Placement.Summary << endl;
+
+	// Stop gracefully when asked to terminate.
+	signal(SIGINT,  [](int) { Interrupted = true; });
+	signal(SIGTERM, [](int) { Interrupted = true; });
+
 	// Take the current time.
 	const auto start = Mark();
 
@@ -142,194 +302,405 @@ void Render(const path& Filename) {
 	vector<thread> workers;
 	for (unsigned worker = 0; worker < Threads; worker++)
 		workers.push_back(thread([&](const unsigned worker) {
-			// Alias this thread's tracing state.
-			auto& state = states[worker];
-
-			// Run this worker until all passes have been completed.
-			for (; pass.fetch_add(1u) < Passes;)
-				// Illuminate the scene...
-				Illuminate(lights, Multiplier,
-					[=, &scene, &state](const auto& Light) {
-						// Start tracing by emitting a photon.
-						Light.Emit(state);
-
-						// Trace and bounce the photon until...
-						// it bounces too many times, or
-						// no intersections were found, or
-						// the trace electively terminates.
-						for (Integer bounce = 0; 
-							bounce < Bounces && Trace(scene, state); 
-							state._Hits++, bounce++);
+			// Pin this thread to its processor, then allocate its tracing state
+			// on the memory of its node. The film buffer is first touched here too.
+			Placement.Enter(worker);
+			states[worker] = MakeNodeLocal<StateType>(Placement.Node(worker));
+			if (!states[worker]) {
+				// Without its state the worker cannot trace, so stop the render.
+				scheduler.Leave(worker);
+				scheduler.Stop();
+				return;
+			}
+
+			// Initialize the tracing state.
+			auto& state = *states[worker];
+			state.Film = { &data, Buffer };
+			for (uint32 stream = 0; stream < RandomStreams::Streams; stream++)
+				state.RNG.Streams.Seed(stream, seeds[worker][stream]);
+
+			state.Film.Config  = { LensRadius };
+			state.Film.Preview = &previews[worker];
+			state.Film.Flushed = &flushed[worker];
+			state.Film.Packed  = Compress;
+			state.Connections  = Connect;
+			state.Scramble     = checkpoint.Header.Scramble;
+
+			// Run this worker until all photons have been emitted.
+			if constexpr (Wavefront) {
+				// Trace each chunk in batches.
+				auto tracer = make_unique<WavefrontTracer<EmissiveType, PhotonSampler>>();
+				for (PhotonChunk chunk; scheduler.Next(worker, chunk); state.Film.Traced(chunk.Size()))
+					VisitLight(lights, chunk.Light, [&](const auto& Light) {
+						tracer->Trace(scene, Light, chunk, Bounces, state);
 					});
+			} else
+				for (PhotonChunk chunk; scheduler.Next(worker, chunk); state.Film.Traced(chunk.Size()))
+					TraceChunk(scene, lights, chunk, Bounces, state);
 		}, worker));
 
+	// Monitor the budgets while photons remain to be handed out.
+	// Once any budget is exhausted, workers finish their chunks and stop.
+	// Checkpoints record the photons whose blocks have been written, every so often.
+	// Photons still buffered or in flight are not counted, so a resumed render
+	// emits them again rather than falling short of its budget.
+	// Without an interrupt or a budget met, the run ends when the photons are spent.
+	string_view reason = Budget.Photons ? "photon budget" :
+		!Budget.Seconds && !Budget.Noise ? "configured passes" : "completed";
+	auto checkpointed = Elapsed(start);
+	for (; scheduler.Remaining() && !scheduler.Stopped(); this_thread::sleep_for(Interval)) {
+		if (Elapsed(start) - checkpointed >= Periodic) {
+			checkpointed = Elapsed(start);
+			checkpoint.Header.Photons = previous + accumulate(flushed.begin(), flushed.end(), 0ull);
+			if (checkpoint.Write(data))
+				cout << "Failed to write checkpoint." << endl;
+		}
+
+		if (Interrupted)
+			reason = "interrupt";
+		else if (Budget.Seconds && Elapsed(start) >= Budget.Seconds)
+			reason = "time budget";
+		else if (Budget.Noise && FilmPreview::Noise(previews, Pixels) <= Budget.Noise)
+			reason = "noise target";
+		else
+			continue;
+
+		scheduler.Stop();
+		break;
+	}
+
 	// Wait for all workers to complete.
 	for (auto& worker : workers)
 		if (worker.joinable())
 			worker.join();
 
+	// Report workers which failed to allocate their tracing state.
+	for (unsigned worker = 0; worker < Threads; worker++)
+		if (!states[worker]) {
+			cout << format("Failed to allocate the tracing state of worker {} on node {}.",
+				worker, Placement.Node(worker)) << endl;
+			reason = "allocation failure";
+		}
+
 	// Measure the time elapsed.
 	const auto elapsed = Elapsed(start);
 
+	// Restore default termination.
+	signal(SIGINT,  SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+
 	// Flush remaining output buffers and collect final stats.
 	uint64 hits = 0, exposures = 0;
-	for (auto& state : states) {
+	array<uint64, StateType::Depths> depths{};
+	vector<uint64> traced(Threads);
+	for (unsigned worker = 0; worker < Threads; worker++) {
+		if (!states[worker])
+			continue;
+
+		auto& state = *states[worker];
 		state.Film.Flush();
 		hits += state._Hits;
 		exposures += state.Film._Exposures;
+		for (uint32 depth = 0; depth < StateType::Depths; depth++)
+			depths[depth] += state._Depths[depth];
+
+		traced[worker] = accumulate(state._Depths.begin(), state._Depths.end(), 0ull);
+	}
+
+	// Return the stream to sequential writes, after the last reserved block.
+	if (data.EndAppend()) {
+		cout << "Failed to end appending to the output file." << endl;
+		return;
 	}
 
+	// Record the final checkpoint, with the streams as the workers left them.
+	const auto emitted = accumulate(flushed.begin(), flushed.end(), 0ull);
+	checkpoint.Header.Photons = previous + emitted;
+	checkpoint.resize(0);
+	for (unsigned worker = 0; worker < Threads; worker++)
+		for (uint32 stream = 0; stream < RandomStreams::Streams; stream++)
+			checkpoint.push_back(states[worker] ?
+				states[worker]->RNG.Streams.Stream(stream) : seeds[worker][stream]);
+
+	if (checkpoint.Write(data))
+		cout << "Failed to write checkpoint." << endl;
+
 	// Close the output file.
 	data.Close();
 
 	// Report statistics.
 	cout << fixed << setprecision(2);
+	cout << emitted / 1e6 << "M photons emitted, " << checkpoint.Header.Photons / 1e6 << "M in total. ";
+	cout << "Stopped by " << reason << "." << endl;
+	cout << "Estimated noise: " << FilmPreview::Noise(previews, Pixels) * 1e2 << "% per pixel." << endl;
 	cout << exposures << " exposures in " << elapsed << " seconds." << endl;
-	cout << hits / 1e6 << "M scene traces @ " << hits / elapsed / 1e6 << "M traces/sec." << endl;
+	cout << hits / 1e6 << "M scene traces @ " << hits / elapsed / 1e6 << "M traces/sec";
+	cout << (Wavefront ? " (wavefront)." : " (scalar).") << endl;
+
+	// Report the distribution of trace depths, and the cost of each exposure.
+	const auto traces = accumulate(depths.begin(), depths.end(), 0ull);
+	float64 bounces = 0;
+	for (uint32 depth = 0; depth < StateType::Depths; depth++)
+		bounces += float64(depth) * depths[depth];
+
+	const auto busy = elapsed * Threads * 1e6;
+	cout << format("Mean depth {:.2f} bounces. Per thread: {:.3f} us per photon, {:.2f} us per exposure.",
+		bounces / max(traces, 1ull), busy / max(emitted, 1ull), busy / max(exposures, 1ull)) << endl;
+
+	// List the depths of the first 99% of traces, then the remainder.
+	cout << "Depths:";
+	uint64 listed = 0;
+	for (uint32 depth = 0; depth < StateType::Depths && listed < traces; depth++) {
+		if (listed * 100 >= traces * 99) {
+			cout << format(" {}+:{:.1f}%", depth, (traces - listed) * 1e2 / traces);
+			break;
+		}
+
+		cout << format(" {}:{:.1f}%", depth, depths[depth] * 1e2 / traces);
+		listed += depths[depth];
+	}
+	cout << endl;
+
+	// Report the time each worker spent without work.
+	for (unsigned worker = 0; worker < Threads; worker++) {
+		const auto idle = scheduler.Idle(worker);
+		cout << format("Worker {} (node {}): {:.2f} ms idle ({:.2f}%).",
+			worker, Placement.Node(worker), idle * 1e3, idle * 1e2 / elapsed) << endl;
+	}
+
+	// Report the throughput of each node, to compare placements across topologies.
+	for (uint32 node = 0; node < Placement.Nodes(); node++) {
+		uint32 workers = 0;
+		uint64 photons = 0;
+		for (unsigned worker = 0; worker < Threads; worker++)
+			if (Placement.Node(worker) == node) {
+				workers++;
+				photons += traced[worker];
+			}
+
+		if (workers)
+			cout << format("Node {}: {} workers, {:.2f}M photons, {:.3f}M photons/sec per worker.",
+				node, workers, photons / 1e6, photons / elapsed / workers / 1e6) << endl;
+	}
+}
+
+// Return the distance to the image plane of an animated frame,
+// whose focus moves away from the lens as the frames advance.
+static Real ImageDistance(const uint32 Frame) {
+	const auto focalDist = 2r + Frame / 32r;
+	return 1r / (1r / FocalLen - 1r / focalDist);
 }
 
 // Develop the image.
 // Captured photons are loaded and projected through a the
-// virtual lens to form a sequence of image files.
-void Develop(const path& Filename) {
-	// Camera configuration
-	constexpr auto Zoom		= 1r;
-	constexpr auto FocalLen	= 1r;
-	constexpr auto FLimit	= 0.8r;
-	
-	constexpr auto Width	= 256u;
-	constexpr auto Height	= 256u;
-
-	constexpr auto Frames	= 256u;
+// virtual lens to form a sequence of image files. Photons
+// are optionally decoded once into a sidecar cache, which
+// later runs project directly.
+void Develop(const path& Filename, const WorkerPlacement& Placement, const uint32 Frames, const bool Cache) {
+	constexpr auto MaxBatch	= 256u;		// Most frames developed at once by a worker (1MB each).
 
 #if !defined(_DEBUG)
-	const     auto Threads = max(thread::hardware_concurrency(), 1u);
+	const     auto Threads = Placement.Workers();
 #else
 	constexpr auto Threads = 1u;
 #endif
 
-	// Scan the input file to estimate exposure.
-	const auto filename = path("out/") / Filename;
-	Real exposure;
-	{
-		// Open the file in read-only mode.
-		DataStream data;
-		if (data.Open(filename, true))
+	// Workers form teams, each developing an equal share of the frames.
+	// With more workers than frames, the members of a team split the
+	// photons between them, each splatting onto images of its own, and
+	// then sum and write the images together. Worker N is member N / Teams
+	// of team N % Teams, and member 0 holds the team's sum.
+	// The sums are added in an order that depends on the number of members,
+	// so images match a single worker's only to within float rounding: a
+	// relative error of about 1e-6 per pixel, which seldom changes an 8-bit value.
+	const auto Teams = min(Threads, Frames);
+	if (!Teams)
+		return;
+
+	// Frames developed per pass over the photons, by each team.
+	// The photons are read and decoded once per pass rather than
+	// once per frame.
+	const auto Batch = clamp((Frames + Teams - 1) / Teams, 1u, MaxBatch);
+
+	// Map the input file into memory, shared by all workers.
+	MappedStream data;
+	if (data.Open(path("out/") / Filename))
+		return;
+
+	// Read the film configuration.
+	ColorFilm16 config;
+	if (config.ReadConfig(data))
+		return;
+
+	// Open the decoded photons of the cache, building it if needed.
+	// Without it, photons are decoded from the input file.
+	PhotonCache cache;
+	const auto cached = SimdLanes && Cache &&
+		!cache.Open<ColorFilm16::value_type>(path("out/") / Filename, data, config.Config.LensRadius);
+
+	// Blocks of photons, split between the members of teams.
+	const auto blocks = cached ? cache.Blocks() : data.Blocks({TAG_Hits, TAG_Packed});
+
+	// Photons unpacked for projection by each worker, on the memory of its node.
+	// These are allocated up front, since the members of a team depend on each other.
+	vector<NodeLocal<DevelopBatch<>>> batches(Threads);
+	for (unsigned worker = 0; worker < Threads; worker++)
+		if (!(batches[worker] = MakeNodeLocal<DevelopBatch<>>(Placement.Node(worker))))
 			return;
 
-		ColorFilm16 film{&data, 1ULL << 20};
+	// Synchronization of each team's members.
+	deque<barrier<>> teams;
+	for (unsigned team = 0; team < Teams; team++)
+		teams.emplace_back((Threads - team + Teams - 1) / Teams);
 
-		// Count the stored photons.
-		uint64 photons = 0;
-		film.ReadHits([&](auto& hits) { photons += hits.size(); });
+	// Images of the current batch, and total brightness of their photons, by each worker.
+	vector<vector<RImage>> images(Threads);
+	vector<float64> brightness(Threads);
 
-		// Compute the exposure normalization factor.
-		exposure = 2r / (Real(photons) / (Width * Height));
-	}
+	// Frames developed, and photons projected onto them, by each worker.
+	vector<uint32> developed(Threads);
+	vector<uint64> projected(Threads);
+
+	// Take the current time, and later that of the first frame handed to the output.
+	const auto start = Mark();
+	atomic_bool firstOut = false;
+	double firstFrame = 0;
+
+	// Frames are appended to a video as they complete, or else encoded and
+	// written to files in the background, while workers develop the next.
+	VideoWriter<RImage> video;
+	if (FrameVideo != VideoFormat::None &&
+		video.Open(format("out/out.{}", Extension(FrameVideo)), FrameVideo, {Width, Height}, FrameRate, Threads * 2))
+		return;
 
-	// Current frame number, synchronized.
-	atomic_uint32_t frameIdx = 0;
+	optional<ImageWriter<RImage>> writer;
+	if (FrameVideo == VideoFormat::None)
+		writer.emplace(FrameFormat, max(Threads / 4, 1u), Threads * 2);
 
 	// Launch worker threads.
 	vector<thread>  workers;
 	for (unsigned t = 0; t < Threads; t++)
-		workers.push_back(thread([&]([[maybe_unused]] const unsigned id) {
-			// Open the file in read-only mode.
-			DataStream data;
-			if (data.Open(filename, true))
-				return;
-
-			ColorFilm16 film{&data, 1ULL << 20};
-
-			// This worker will process a single frame by itself.
-			for (unsigned frame; (frame = frameIdx.fetch_add(1u)) < Frames;) {
-				// Rewind the data stream and [re]initialize the film.
-				if (data.Rewind() || film.ReadConfig())
-					continue;
-
-				// Output Image
-				RImage image({Width, Height});
+		workers.push_back(thread([&](const unsigned id) {
+			// Pin this thread to its processor. The film buffer and
+			// images are then allocated on the memory of its node.
+			Placement.Enter(id);
+
+			// This worker's team, and its share of the team's photons.
+			const auto team    = id % Teams;
+			const auto member  = id / Teams;
+			const auto members = (Threads - team + Teams - 1) / Teams;
+			const auto parts   = Partition(blocks, members);
+			const span<const IndexEntry> share(blocks.data() + parts[member], parts[member + 1] - parts[member]);
+			auto& sync = teams[team];
+
+			// Film for reading the mapped file, holding unpacked records.
+			ColorFilm16 film;
+			auto& photons = *batches[id];
+
+			// Distance to the image plane of each frame in the batch.
+			vector<Real> imgDists;
+
+			// This team will process its share of the frames by itself, a batch at a time.
+			const auto last = uint32(uint64(team + 1) * Frames / Teams);
+			for (auto first = uint32(uint64(team) * Frames / Teams); first < last; first += Batch) {
+				const auto count = min(Batch, last - first);
+
+				// Output Images
+				auto& output = images[id];
+				output.clear();
+				for (unsigned index = 0; index < count; index++)
+					output.emplace_back(Coord{Width, Height});
 				const auto half		= RVector{Width, Height} / 2r;	// Image center.
 
 				// Per-Frame / Animated Parameters
-				const auto focalDist = 2r + frame / 32r;
+				imgDists.clear();
+				for (unsigned index = 0; index < count; index++)
+					imgDists.push_back(ImageDistance(first + index));
 
 				// Virtual Lens Configuration
-				const auto lensRad	= film.Config.LensRadius;
+				const auto lensRad	= config.Config.LensRadius;
 				const auto radSq	= lensRad * lensRad;
 				const auto fLimit	= RVector{1, FLimit}.Normalized().y;
 
 				// Scale the virtual image to fit the real image.
 				const auto hScale	= half * lensRad * FocalLen * Zoom * csqrt(2r) / -2r;
 
-				// Load all photons from the file.
-				film.ReadHits([&](auto& hits) {
-					// Process each captured photon.
-					for (const auto& hit : hits) {
-						// Decode the photon's hit position.
-						// Relative to the virtual lens position.
-						RVector recPos{hit.Pos.u, hit.Pos.v};
-						recPos *= film.Config.LensRadius;
-
-						// Decode the photon's direction.
-						// Relative to the virtual lens direction.
-						RVector recDir{hit.Dir.u, hit.Dir.v};
-						recDir.z = sqrt(1r - recDir.x*recDir.x - recDir.y*recDir.y);
-
-						// Compute deflection at this location on the virtual lens.
-						const auto lensDef = RVector{recPos.x, recPos.y, FocalLen}.Normalized();
-
-						// Eliminate photons masked by the aperture.
-						if (recDir.Dot(lensDef) < fLimit)
-							continue;
-
-						// Add the virtual lens surface normal to the ray direction.
-						recDir.z = 1r - recDir.z;
-
-						// Compute the projected ray's new direction.
-						const RVector projDir = (recDir - lensDef).Normalized();
-
-						// Compute the distance to the image plane.
-						const auto imgDist  = 1r / (1r / FocalLen - 1r / focalDist);
-
-						// Compute where the projected ray intersects the image plane.
-						const auto imgPos = recPos + projDir * imgDist / -projDir.z;
-
-						// Normalize and center the image.
-						const auto pixel = imgPos * hScale + half;
-
-						// Perform lower boundary checks.
-						if (pixel.x < 0r || pixel.y < 0r ||
-							isnan(pixel.x) || isinf(pixel.x) ||
-							isnan(pixel.y) || isinf(pixel.y))
-							continue;
-
-						// Convert to pixel coordinates.
-						// Perform upper boundary checks.
-						const Coord coord{pixel.x, pixel.y};
-						if (coord.x >= image.Dimensions.x ||
-							coord.y >= image.Dimensions.y)
-							continue;
-
-						// Decode the photon color.
-						const auto color = RGBSystem::Load(hit.Clr);
-						
-						// Accumulate color on this pixel.
-						image(coord) += color;
+				// Total the brightness of the stored photons, which are
+				// weighted when connected to the lens, for the exposure.
+				float64 bright = 0;
+
+				// Expose the image of each frame to the loaded photons.
+				const auto expose = [&](const uint32 Records) {
+					for (unsigned index = 0; index < count; index++)
+						photons.Expose(output[index], imgDists[index], hScale, half);
+					projected[id] += uint64(Records) * count;
+				};
+
+				// Load this member's share of the photons, once for the batch,
+				// and project them through the virtual lens.
+				if (cached)
+					cache.Read(share, [&](const DecodedPhotons& Decoded, const uint32 Records) {
+						photons.Load(Decoded, Records, FocalLen, fLimit, bright);
+						expose(Records);
+					});
+				else if constexpr (SimdLanes)
+					film.ReadHits(data, share, [&](auto& hits) {
+						for (size_t offset = 0; offset < hits.size(); offset += photons.Size) {
+							const auto records = uint32(min(hits.size() - offset, size_t(photons.Size)));
+							photons.Load(&hits[offset], records, lensRad, FocalLen, fLimit, bright);
+							expose(records);
+						}
+					});
+				else
+					film.ReadHits(data, share, [&](auto& hits) {
+						DevelopScalar(hits, output, imgDists, lensRad, FocalLen, fLimit, hScale, half, bright);
+						projected[id] += hits.size() * count;
+					});
+
+				brightness[id] = bright;
+				sync.arrive_and_wait();
+
+				// Compute the exposure normalization factor, from the whole team's photons.
+				bright = 0;
+				for (unsigned other = team; other < Threads; other += Teams)
+					bright += brightness[other];
+				const auto exposure = 2r / (Real(bright) / (Width * Height));
+
+				// Sum the team's images into member 0's, and normalize intensity,
+				// over this member's band of rows.
+				const auto begin = size_t(member)     * Height / members * Width;
+				const auto end   = size_t(member + 1) * Height / members * Width;
+				for (unsigned index = 0; index < count; index++) {
+					auto& image = images[team][index];
+					for (auto pixel = begin; pixel < end; pixel++) {
+						auto color = image[pixel];
+						for (unsigned other = team + Teams; other < Threads; other += Teams)
+							color += images[other][index][pixel];
+						image[pixel] = color * exposure;
 					}
-				});
+				}
+
+				sync.arrive_and_wait();
+
+				// Write the team's images, taking turns among its members. Images
+				// queued for files are moved to the writer, as the team is done with them.
+				for (unsigned index = member; index < count; index += members) {
+					// Report the frame number being written.
+					cout << format("{} ", first + index);
 
-				// Normalize intensity.
-				image.ForEach([exposure, &image](const Coord& Pixel) {
-					image(Pixel) *= exposure;
-				});
+					if constexpr (FrameVideo != VideoFormat::None)
+						video.Write(first + index, images[team][index]);
+					else
+						writer->Write(format("out/out{:04d}.{}", first + index, Extension(FrameFormat)),
+							move(images[team][index]));
+					developed[id]++;
 
-				// Report the frame number being written.
-				cout << format("{} ", frame);
+					if (!firstOut.exchange(true))
+						firstFrame = Elapsed(start);
+				}
 
-				// Write the image to disk.
-				string filename = format("out/out{:04d}.tga", frame);
-				image.Write(filename);
+				// Member 0's images are replaced by the next batch.
+				sync.arrive_and_wait();
 			}
 		}, t));
 
@@ -337,10 +708,342 @@ void Develop(const path& Filename) {
 	for (auto& worker : workers)
 		if (worker.joinable())
 			worker.join();
+
+	// Wait for the last frames to be written, and finish the video.
+	const auto failed = (writer && writer->Finish()) | video.Close();
+	if (failed)
+		cout << endl << "Failed to write frames.";
+
+	// Report the frame rate of each node, to compare placements across topologies.
+	const auto elapsed = Elapsed(start);
+	cout << endl << format("{} frames in {:.2f} seconds, the first in {:.3f} seconds by {} workers.",
+		Frames, elapsed, firstFrame, Threads) << endl;
+	for (uint32 node = 0; node < Placement.Nodes(); node++) {
+		uint32 workers = 0, frames = 0;
+		uint64 photons = 0;
+		for (unsigned worker = 0; worker < Threads; worker++)
+			if (Placement.Node(worker) == node) {
+				workers++;
+				frames  += developed[worker];
+				photons += projected[worker];
+			}
+
+		if (workers)
+			cout << format("Node {}: {} workers, {} frames, {:.3f} frames/sec, {:.2f}M photons/sec per worker.",
+				node, workers, frames, frames / elapsed / workers, photons / elapsed / workers / 1e6) << endl;
+	}
+}
+
+// Preview the image while it is being rendered.
+// Follows the growing file, projecting only the blocks of photons
+// completed since the last look through the virtual lens, focused
+// as the first frame, and accumulating them into a persistent image.
+// A refreshed preview is written periodically, until the renderer
+// closes the file by writing its index, or the process is interrupted.
+// The file is only mapped while looking, never between looks.
+void Preview(const path& Filename, const float64 Seconds) {
+	constexpr auto Interval = 100ms;		// Time between checks for interruption
+
+	signal(SIGINT,  [](int) { Interrupted = true; });
+	signal(SIGTERM, [](int) { Interrupted = true; });
+
+	// Photons accumulated so far, and their total brightness.
+	RImage image({Width, Height});
+	float64 bright = 0;
+	uint64 photons = 0;
+
+	auto batch = make_unique<DevelopBatch<>>();
+	ColorFilm16 film;
+
+	// Offset of the first block not yet projected, and a copy of the
+	// bytes before it, to recognize the file being replaced.
+	constexpr auto Tail = 256u;
+	auto cursor = MappedStream::Begin();
+	vector<uint8> tail;
+
+	for (auto closed = false; !closed && !Interrupted;) {
+		const auto start = Mark();
+
+		// Map the file as it stands. Blocks in flight are headed by placeholders
+		// until complete, and the walk stops at the first one, to resume from
+		// there next time.
+		MappedStream data;
+		if (!data.Open(path("out/") / Filename) && !film.ReadConfig(data)) {
+			// Start over when the file was replaced by a new render, which may
+			// have grown past the cursor: the bytes before it have changed.
+			if (data._Size < cursor || !equal(tail.begin(), tail.end(), data._Data + cursor - tail.size())) {
+				image = RImage({Width, Height});
+				bright  = 0;
+				photons = 0;
+				cursor  = MappedStream::Begin();
+				tail.clear();
+			}
+
+			vector<IndexEntry> blocks;
+			while (const auto* block = data.Next(cursor,
+				{TAG_Hits, TAG_Packed, DataStream::PendingIdent, DataStream::IndexIdent})) {
+				if (block->Ident == DataStream::PendingIdent) {
+					cursor -= block->Size;
+					break;
+				}
+
+				if (block->Ident == DataStream::IndexIdent) {
+					closed = true;
+					break;
+				}
+
+				blocks.push_back({cursor - block->Size, block->Size, 0, block->Ident});
+			}
+
+			const auto kept = min<uint64>(cursor - MappedStream::Begin(), Tail);
+			tail.assign(data._Data + cursor - kept, data._Data + cursor);
+
+			// Project the new photons through the virtual lens.
+			const auto lensRad	= film.Config.LensRadius;
+			const auto fLimit	= RVector{1, FLimit}.Normalized().y;
+			const auto half		= RVector{Width, Height} / 2r;
+			const auto hScale	= half * lensRad * FocalLen * Zoom * csqrt(2r) / -2r;
+			const auto imgDist	= ImageDistance(0);
+
+			film.ReadHits(data, blocks, [&](auto& hits) {
+				for (size_t offset = 0; offset < hits.size(); offset += batch->Size) {
+					const auto records = uint32(min(hits.size() - offset, size_t(batch->Size)));
+					batch->Load(&hits[offset], records, lensRad, FocalLen, fLimit, bright);
+					batch->Expose(image, imgDist, hScale, half);
+					photons += records;
+				}
+			});
+
+			// Write the preview, normalized to the photons so far.
+			if (!blocks.empty() && bright > 0) {
+				const auto exposure = 2r / (Real(bright) / (Width * Height));
+				auto preview = image;
+				for (auto& color : preview)
+					color = color * exposure;
+
+				preview.Write("out/preview.tga");
+				cout << format("{:.2f}M photons.", photons / 1e6) << endl;
+			}
+		}
+
+		// Unmap the file while waiting, so the renderer may resize it.
+		data.Close();
+		while (!closed && !Interrupted && Elapsed(start) < Seconds)
+			this_thread::sleep_for(Interval);
+	}
+
+	signal(SIGINT,  SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+}
+
+// Measure the convergence of a sampler on the default scene.
+// Independently seeded runs are traced in parallel, each binning
+// its photons as a lens focused at infinity would image them. The
+// spread of the runs' images after each level of photons per light
+// is the relative error of a single run. Returns the error per level.
+template <typename SamplerType>
+static vector<float64> Converge(const vector<uint64>& Levels, const uint32 Runs, const uint32 Threads) {
+	constexpr auto Bounces = 64u;
+	constexpr auto Lights  = uint32(tuple_size_v<decltype(DefaultLights)>);
+
+	using StateType = TraceState<EmissiveType, BinnedFilm<ColorFilm16::value_type>, SamplerType>;
+
+	// Images of every run after each level, by level then run.
+	vector<FilmPreview::BinsType> images(Levels.size() * Runs);
+
+	// Launch worker threads, each tracing whole runs.
+	atomic_uint32_t runIdx = 0;
+	vector<thread> workers;
+	for (unsigned t = 0; t < Threads; t++)
+		workers.push_back(thread([&] {
+			auto state = make_unique<StateType>();
+			for (uint32 run; (run = runIdx.fetch_add(1u)) < Runs;) {
+				// Each run has its own random sequence and scramble seed.
+				Random seed(run);
+				*state = { {}, seed };
+				state->Scramble    = uint32(seed());
+				state->Connections = Connect;
+
+				// Trace each level's photons from every light, then take a snapshot.
+				uint64 traced = 0;
+				for (size_t level = 0; level < Levels.size(); traced = Levels[level++]) {
+					for (uint32 light = 0; light < Lights; light++)
+						TraceChunk(DefaultScene, DefaultLights, {light, traced, Levels[level]}, Bounces, *state);
+
+					images[level * Runs + run] = state->Film.Bins;
+				}
+			}
+		}));
+
+	for (auto& worker : workers)
+		worker.join();
+
+	// Compare the runs' images: the variance of each bin against its squared mean.
+	vector<float64> errors;
+	for (size_t level = 0; level < Levels.size(); level++) {
+		float64 variance = 0, energy = 0;
+		for (uint32 bin = 0; bin < FilmPreview::Size * FilmPreview::Size; bin++) {
+			float64 sum = 0, sumSq = 0;
+			for (uint32 run = 0; run < Runs; run++) {
+				const auto value = images[level * Runs + run][bin];
+				sum   += value;
+				sumSq += value * value;
+			}
+
+			const auto mean = sum / Runs;
+			variance += (sumSq - sum * mean) / (Runs - 1);
+			energy   += mean * mean;
+		}
+
+		errors.push_back(energy > 0 ? sqrt(variance / energy) : Infinity);
+	}
+
+	return errors;
+}
+
+// Compare the convergence of each sampler on the default scene.
+// Photons is the most photons emitted per light. Levels start at
+// 1024 photons per light and grow fourfold, so each one ends on
+// a power of two, where the quasi-random sequences are balanced.
+void Converge(const uint64 Photons) {
+	constexpr auto Runs    = 8u;			// Independent runs per sampler.
+	const     auto Threads = max(thread::hardware_concurrency(), 1u);
+
+	vector<uint64> levels;
+	for (auto photons = 1ull << 10; photons <= Photons; photons *= 4)
+		levels.push_back(photons);
+
+	if (levels.empty() || LoadScene(DefaultScene)) {
+		cout << "Nothing to measure." << endl;
+		return;
+	}
+
+	// Measure each sampler in turn.
+	struct Result {
+		string_view		Name;
+		vector<float64>	Errors;
+		float64			Seconds;
+	};
+
+	const auto measure = [&]<typename SamplerType>(const string_view Name) {
+		const auto start  = Mark();
+		auto errors = Converge<SamplerType>(levels, Runs, Threads);
+		return Result{Name, move(errors), Elapsed(start)};
+	};
+
+	const array results = {
+		measure.template operator()<PseudoSampler>("Xoroshiro"),
+		measure.template operator()<SobolSampler >("Sobol"),
+		measure.template operator()<HaltonSampler>("Halton"),
+	};
+
+	// Report the relative error per level, the order of convergence, and the time taken.
+	cout << format("{:>12}", "Photons");
+	for (const auto& result : results)
+		cout << format("{:>12}", result.Name);
+	cout << endl;
+
+	for (size_t level = 0; level < levels.size(); level++) {
+		cout << format("{:>12}", levels[level]);
+		for (const auto& result : results)
+			cout << format("{:>11.3f}%", result.Errors[level] * 1e2);
+		cout << endl;
+	}
+
+	// Error falls as Photons^Order: -0.5 for independent samples.
+	cout << format("{:>12}", "Order");
+	for (const auto& result : results)
+		cout << format("{:>12.3f}", levels.size() < 2 ? 0.0 :
+			log(result.Errors.back() / result.Errors.front()) / log(float64(levels.back()) / levels.front()));
+	cout << endl;
+
+	cout << format("{:>12}", "Seconds");
+	for (const auto& result : results)
+		cout << format("{:>12.2f}", result.Seconds);
+	cout << endl;
 }
 
 // Program entry point
-int main() {
-	Render("out.dat");
-	Develop("out.dat");
+// Usage: StaticRay [--resume] [--seconds N] [--photons N] [--noise N] [--pin] [--cores] [--workers N] [--frames N] [--cache]
+//        StaticRay --converge N
+//        StaticRay --test		(check the fast paths against their references)
+//        StaticRay --follow N	(preview a render in progress every N seconds)
+int main(int argc, char* argv[]) {
+	// Parse the optional rendering budgets and worker placement.
+	RenderBudget budget;
+	uint64 converge = 0;
+	float64 follow = 0;
+	uint32 frames = 256, workers = 0;
+	bool resume = false, pin = false, cores = false, cache = false, test = false;
+	for (int arg = 1; arg < argc; arg++) {
+		const string_view option = argv[arg];
+		if (option == "--resume")
+			resume = true;
+		else if (option == "--pin")
+			pin = true;
+		else if (option == "--cores")
+			cores = true;
+		else if (option == "--cache")
+			cache = true;
+		else if (option == "--test")
+			test = true;
+		else {
+			// Valued options take the next argument.
+			if (++arg == argc) {
+				cout << format("Missing value for option {}.", option) << endl;
+				return 1;
+			}
+
+			const auto value = strtod(argv[arg], nullptr);
+			if (option == "--seconds")
+				budget.Seconds = value;
+			else if (option == "--photons")
+				budget.Photons = uint64(value);
+			else if (option == "--noise")
+				budget.Noise = value;
+			else if (option == "--converge")
+				converge = uint64(value);
+			else if (option == "--frames")
+				frames = uint32(value);
+			else if (option == "--workers")
+				workers = uint32(value);
+			else if (option == "--follow")
+				follow = value;
+			else {
+				cout << format("Unknown option {}.", option) << endl;
+				return 1;
+			}
+		}
+	}
+
+	// Check the fast paths against their references instead of rendering.
+	if (test) {
+		auto failed = CheckRandomStreams();
+		failed |= CheckHitCodec<ColorFilm16::value_type>();
+		failed |= CheckPartition();
+		failed |= CheckDevelop<ColorFilm16::value_type>();
+		return failed;
+	}
+
+	// Benchmark the samplers instead of rendering.
+	if (converge) {
+		Converge(converge);
+		return 0;
+	}
+
+	// Preview the render of another process instead of rendering.
+	if (follow > 0) {
+		Preview("out.dat", follow);
+		return 0;
+	}
+
+	// Place workers across the processors, optionally pinned, with or
+	// without sharing physical cores, and optionally fewer of them.
+	const WorkerPlacement placement(cores ? SmtPolicy::Cores : SmtPolicy::Siblings, pin, workers);
+
+	Render("out.dat", budget, resume, placement);
+
+	// Skip development when rendering was interrupted.
+	if (!Interrupted)
+		Develop("out.dat", placement, frames, cache);
 }
\ No newline at end of file
@@ -7,18 +7,31 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <barrier>
+#include <bit>
 #include <cassert>
+#include <charconv>
 #include <chrono>
+#include <condition_variable>
+#include <csignal>
 #include <cmath>
+#include <deque>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <functional>
+#include <intrin.h>
+#include <immintrin.h>
 #include <iostream>
 #include <mutex>
+#include <numbers>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <span>
 #include <sstream>
 #include <thread>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -32,63 +45,102 @@ using namespace filesystem;
 #include "Types.h"
 #include "Vector.h"
 #include "Image.h"
+#include "Video.h"
+#include "Simd.h"
 #include "Xoroshiro.h"
 #include "Utility.h"
+#include "Samplers.h"
+#include "Scheduler.h"
+#include "Topology.h"
 #include "Stream.h"
+#include "Codec.h"
 #include "Film.h"
+#include "Checkpoint.h"
+#include "Scene.h"
 #include "Colors.h"
 #include "Materials.h"
 #include "Shapes.h"
 #include "Lens.h"
+#include "Mesh.h"
 #include "Lights.h"
+#include "Wavefront.h"
+#include "Develop.h"
+#include "Tests.h"
 
 
 // Trace State ============================================
 
 
-template <typename ColorType, typename FilmType>
-struct TraceState {
-	using FuncFunc  = function<bool(void)>;
+// Aligned to a cache line so per-thread states never share one.
+template <typename ColorType, typename FilmType, typename SamplerType = PseudoSampler>
+struct alignas(CacheLine) TraceState {
+	static constexpr uint32 Depths = 64;	// Depth histogram bins. The last collects deeper traces.
 
 	FilmType	Film;				// Imaging film (shared across threads).
-	Random		RNG;				// Random number generator for this thread.
+	RandomPool	RNG;				// Random number generator for this thread.
+	uint32		Scramble = 0;		// Scramble seed of quasi-random samples (shared by all threads).
+	bool		Connections = false;	// Connect diffuse interactions to the lens.
 
 	RVector		Position;			// Current position of the photon.
 	RVector		Direction;			// Current direction of the photon.
 	ColorType	Color;				// Current color of the photon.
 
-	RVector		_PoolRand;			// A small pool of random floats.
-	Integer		_PoolIndex = 0;		// Current in random pool index.
+	SamplerType	Sampler;			// Sampler of the current photon.
 
 	Real		_HitDist;			// Distance to the nearest intersection.
 	RVector		_HitNorm;			// Surface normal of the intersected shape.
-	FuncFunc	_HitFunc;			// Callback for the nearest intersection.
+	uint32		_HitShape;			// Scene index of the nearest intersected shape.
+	uint32		_HitPrim;			// Primitive within the nearest shape (e.g. mesh triangle).
+
+	ColorType	_Deposit;			// Color reflected by the last diffuse interaction.
+	bool		_Connect = false;	// Is the deposit waiting to be connected to the lens?
+	bool		_Diffuse = false;	// Was the photon's last interaction connected to the lens?
 
 	uint64		_Hits = 0;			// Statistics: Hit counter.
+	array<uint64, Depths> _Depths{};	// Statistics: Traces terminated at each bounce depth.
 
 	// Reset the trace for the next bounce.
 	inline void Reset() {
-		_HitDist = Infinity;
-		_HitFunc = nullptr;
+		_HitDist  = Infinity;
+		_HitShape = NoShape;
 	}
 
 	// Update state when a nearer shape is intersected.
-	inline void Hit(const Real Distance, FuncFunc Interface) {
+	inline void Hit(const Real Distance) {
 		_HitDist = Distance;
-		_HitFunc = Interface;
 	}
 
-	// Returns a random Real in the range [0..1).
-	// Uses a pool and regenerates as needed.
-	Real PoolRNG() {
-		// Retrieve and update the current pool index.
-		const auto idx = _PoolIndex++ & 3;
-		
-		// When appropriate, regenerate the pool.
-		if (!idx)
-			_PoolRand = RandomXYZWUnsigned(RNG());
-
-		// Return the random number.
-		return _PoolRand[idx];
+	// Deposit the color reflected by a diffuse interaction, so the tracer
+	// can connect it to the lens. Photons leaving a connected interaction
+	// are no longer captured by the lens directly, which would count them twice.
+	inline void Deposit(const ColorType& Reflected) {
+		_Deposit = Reflected;
+		_Connect = Connections;
+		_Diffuse = Connections;
+	}
+
+	// Start sampling a photon, by its index among the light's photons.
+	inline void Start(const uint64 Photon, const uint32 Light) {
+		Sampler.Start(Photon, HashCombine(Scramble, Light));
+	}
+
+	// Returns a sample in the range [0..1).
+	inline Real Sample() {
+		return Sampler.Next(*this);
+	}
+
+	// Returns a sampled 3D unit vector.
+	inline RVector SampleNormal() {
+		return Sampler.Normal(*this);
+	}
+
+	// Returns a sampled 2D vector (with Z = 0) within a unit disk.
+	inline RVector SampleDisk() {
+		return Sampler.Disk(*this);
+	}
+
+	// Record traces terminated after the supplied number of bounces.
+	inline void Terminate(const uint32 Depth, const uint64 Traces = 1) {
+		_Depths[min(Depth, Depths - 1)] += Traces;
 	}
 };
\ No newline at end of file
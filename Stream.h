@@ -10,11 +10,33 @@
 // and all other blocks are read/written thereafter. The 
 // wrapper facilitates seeking, reading, and writing block 
 // headers and user data.
+//
+// Blocks may also be appended concurrently without holding
+// the lock: a writer reserves the block's byte range with an
+// atomic add to the tail of the file, then writes it there
+// with positional writes. The block is first headed by a
+// placeholder carrying its size under the pending tag, then
+// its payload is written, and its real header last. Scans
+// step over blocks in flight, and a header under any other
+// tag heads a complete block. A session appending to a file
+// voids the blocks a killed session left in flight.
+// Positional writes are overlapped, so they may be left in
+// flight while the caller carries on with its work.
+//
+// On closing, an index of every block is written after the
+// last, with a trailer at the very end of the file locating
+// it. Seeking jumps straight to blocks through the index, and
+// appending drops the index and starts a new one in its place.
+// Files without an index are indexed when they are scanned.
 
 
 struct DataStream {
 	static constexpr uint16	BlockMagic   = 'ST';	// "TS" for Tagged Stream
 	static constexpr uint8	FileIdent    = 0;
+	static constexpr uint16	IndexIdent   = 0xFF;		// Reserved for the block index.
+	static constexpr uint16	PendingIdent = 0xFE;		// Reserved for blocks whose payload is in flight.
+	static constexpr uint16	VoidIdent    = 0xFD;		// Reserved for blocks abandoned in flight.
+	static constexpr uint32	IndexMagic   = 'STIX';		// Marks the index trailer.
 	static constexpr uint8	VersionMajor = 1;
 	static constexpr uint8	VersionMinor = 1;
 
@@ -61,13 +83,85 @@ struct DataStream {
 		}
 	};
 
+	// Block Index Entry
+	struct IndexEntry {
+		uint64		Offset;			// File offset of the block.
+		uint32		Size;			// Block size in bytes.
+		uint32		Count;			// First word of the user header, counting the records of hit blocks.
+		uint16		Ident;			// Block type identifier.
+		uint16		_Reserved[3];
+	};
+
+	// Block Index Trailer
+	// The last bytes of an indexed file.
+	struct IndexTrailer {
+		uint64	Offset;					// File offset of the index block.
+		uint32	Magic = IndexMagic;
+		uint32	_Reserved = 0;
+	};
+
+	// Block Index Header
+	// Followed by the entries of all other blocks, by offset, then the trailer.
+	struct IndexHeader : BlockHeader {
+		uint32	Count;
+
+		IndexHeader(const uint32 Count = 0) :
+			BlockHeader(IndexIdent, Bytes(Count)),
+			Count(Count) {}
+
+		[[nodiscard]] static constexpr size_t Bytes(const uint32 Count) {
+			return sizeof IndexHeader + sizeof IndexEntry * Count + sizeof IndexTrailer;
+		}
+
+		[[nodiscard]] inline bool Validate() const {
+			return BlockHeader::Validate(IndexIdent, uint32(Bytes(Count)));
+		}
+	};
+
+	// Asynchronous Transfer
+	// A positional write, left in flight until completed.
+	struct AsyncIO {
+		OVERLAPPED	_Overlapped{};		// Offset and completion event.
+		DWORD		_Bytes = 0;			// Bytes to transfer.
+		bool		_Pending = false;	// Is the transfer in flight?
+
+		AsyncIO() = default;
+		AsyncIO(const AsyncIO&) = delete;
+
+		AsyncIO& operator = (AsyncIO&& Other) noexcept {
+			assert(!_Pending && !Other._Pending);
+			swap(_Overlapped.hEvent, Other._Overlapped.hEvent);
+			return *this;
+		}
+
+		~AsyncIO() {
+			assert(!_Pending);
+			if (_Overlapped.hEvent)
+				CloseHandle(_Overlapped.hEvent);
+		}
+
+		[[nodiscard]] inline bool Pending() const {
+			return _Pending;
+		}
+	};
+
 	mutex	_Lock;		// Synchronization mechanism
 	fstream	_File{};	// File stream
+	path	_Path;		// Path of the open file
+
+	HANDLE			_Handle = INVALID_HANDLE_VALUE;	// Overlapped handle, for positional transfers.
+	bool			_Appending = false;				// Are blocks appended at reserved offsets?
+	atomic_uint64_t	_Tail = 0;						// End of the reserved blocks.
+
+	mutex				_IndexLock;			// Guards the index while appending.
+	vector<IndexEntry>	_Index;				// Entries of the blocks, by offset.
+	bool				_Indexed = false;	// Does the index cover every block?
+	bool				_Dirty = false;		// Must the index be written on closing?
 
 	~DataStream() {
 		// Ensure the file is closed on destruction.
 		if (_File.is_open())
-			_File.close();
+			Close();
 	}
 
 	// Obtain ownership of the stream's mutex.
@@ -81,8 +175,13 @@ struct DataStream {
 	bool New(const path& Filename) {
 		assert(Filename.has_filename() && !_File.is_open());
 
+		_Path = Filename;
 		_File.open(Filename, ios::in | ios::out | ios::binary | ios::trunc);
-		return !_File.is_open() || Write(FileHeader{});
+
+		// Index the blocks from the start.
+		_Index.clear();
+		_Indexed = _Dirty = true;
+		return !_File.is_open() || Write(FileHeader{}) || OpenHandle(true);
 	}
 
 	// Open an existing file and seek to the end.
@@ -91,8 +190,38 @@ struct DataStream {
 		assert(Filename.has_filename() && !_File.is_open());
 
 		FileHeader hdr;
+		_Path = Filename;
 		_File.open(Filename, ios::in | ios::out | ios::binary);
-		return !_File.is_open() || ReadHeader(hdr) || SeekTail();
+		if (!_File.is_open() || ReadHeader(hdr) || OpenHandle(true))
+			return true;
+
+		// Find the end through the index, or by scanning the blocks. Blocks are
+		// appended in place of the index, and it is rewritten on closing.
+		LoadIndex();
+		if (SeekTail())
+			return true;
+
+		// Void any blocks left in flight, then end the file after the last block.
+		const auto tail = _File.tellg();
+		_Dirty = true;
+		return VoidPending() || Truncate(uint64(streamoff(tail))) || _File.seekp(tail).fail();
+	}
+
+	// Void the indexed blocks a killed session left in flight, so
+	// that readers following the file stop waiting for them.
+	// Returns true on error.
+	bool VoidPending() {
+		for (auto& entry : _Index) {
+			if (entry.Ident != PendingIdent)
+				continue;
+
+			entry.Ident = VoidIdent;
+			_File.seekp(streamoff(entry.Offset));
+			if (Write(BlockHeader(VoidIdent, entry.Size)))
+				return true;
+		}
+
+		return false;
 	}
 
 	// Open an existing file, optionally in read-only mode.
@@ -102,8 +231,14 @@ struct DataStream {
 
 		FileHeader hdr;
 		const auto out = ReadOnly ? 0 : ios::out;
+		_Path = Filename;
 		_File.open(Filename, ios::in | out | ios::binary);
-		return !_File.is_open() || ReadHeader(hdr);
+		if (!_File.is_open() || ReadHeader(hdr) || OpenHandle(!ReadOnly))
+			return true;
+
+		// The index is optional.
+		LoadIndex();
+		return Rewind();
 	}
 
 	// Close an open file.
@@ -111,10 +246,214 @@ struct DataStream {
 	bool Close() {
 		assert(_File.is_open());
 		
+		const auto error = EndAppend() || (_Dirty && WriteIndex());
+		_Index.clear();
+		_Indexed = _Dirty = false;
+
+		if (_Handle != INVALID_HANDLE_VALUE)
+			CloseHandle(_Handle);
+		_Handle = INVALID_HANDLE_VALUE;
+
 		_File.close();
+		return _File.fail() || error;
+	}
+
+	// Open the overlapped handle of the file, alongside the file stream.
+	// Returns true on error.
+	bool OpenHandle(const bool Writable) {
+		const auto access = GENERIC_READ | (Writable ? GENERIC_WRITE : 0);
+		_Handle = CreateFileW(_Path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+		return _Handle == INVALID_HANDLE_VALUE;
+	}
+
+	// Begin appending blocks with positional writes, from the current position.
+	// Buffered writes are flushed first. Returns true on error.
+	bool BeginAppend() {
+		assert(_File.is_open() && !_Appending);
+
+		_File.flush();
+		const auto tail = _File.tellp();
+		if (_File.fail())
+			return true;
+
+		_Tail = uint64(streamoff(tail));
+		_Appending = true;
+		return false;
+	}
+
+	// Stop appending with positional writes, and move the
+	// stream position to the end of the reserved blocks.
+	// Returns true on error.
+	bool EndAppend() {
+		if (!_Appending)
+			return false;
+
+		_Appending = false;
+		_File.clear();
+		_File.seekp(streamoff(_Tail.load()));
 		return _File.fail();
 	}
 
+	// Is the stream appending with positional writes?
+	[[nodiscard]] inline bool Appending() const {
+		return _Appending;
+	}
+
+	// Reserve a block at the tail of the file, sized by its header, and head it
+	// with a placeholder under the pending tag until its real header is written.
+	// Returns true on error.
+	template <typename HeaderType>
+	bool Reserve(const HeaderType& Header, uint64& Offset, AsyncIO& IO) {
+		assert(Appending());
+		Offset = _Tail.fetch_add(Header.Size);
+		AddEntry(Entry(Offset, Header));
+
+		const BlockHeader placeholder(PendingIdent, Header.Size);
+		return BeginWriteAt(Offset, &placeholder, 1, IO) || Complete(IO);
+	}
+
+	// Begin writing a sequence of objects at an offset, without the lock.
+	// The storage must stay untouched until the transfer is completed.
+	// Returns true on error.
+	template <typename DataType>
+	bool BeginWriteAt(const uint64 Offset, const DataType* const Storage, const size_t Count, AsyncIO& IO) {
+		const auto bytes = sizeof DataType * Count;
+
+		assert(bytes < (1ULL << 32));
+		return Begin(IO, Offset, bytes) ||
+			Started(IO, WriteFile(_Handle, Storage, DWORD(bytes), nullptr, &IO._Overlapped));
+	}
+
+	// Wait for a transfer to complete, if one is in flight.
+	// Returns true on error, including a short transfer.
+	bool Complete(AsyncIO& IO) {
+		if (!IO._Pending)
+			return false;
+
+		IO._Pending = false;
+		DWORD bytes = 0;
+		return !GetOverlappedResult(_Handle, &IO._Overlapped, &bytes, TRUE) || bytes != IO._Bytes;
+	}
+
+	// Has a transfer in flight finished? Does not wait.
+	[[nodiscard]] static inline bool Done(const AsyncIO& IO) {
+		return IO._Pending && HasOverlappedIoCompleted(&IO._Overlapped);
+	}
+
+	// Prepare a transfer of a number of bytes at an offset.
+	// Returns true on error.
+	bool Begin(AsyncIO& IO, const uint64 Offset, const size_t Bytes) {
+		assert(_Handle != INVALID_HANDLE_VALUE && !IO._Pending);
+
+		// Each transfer waits on an event of its own, as other threads transfer concurrently.
+		auto& overlapped = IO._Overlapped;
+		if (!overlapped.hEvent)
+			overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+
+		overlapped.Offset     = DWORD(Offset);
+		overlapped.OffsetHigh = DWORD(Offset >> 32);
+		IO._Bytes = DWORD(Bytes);
+		return !overlapped.hEvent;
+	}
+
+	// Note whether a transfer started, whether or not it completed immediately.
+	// Returns true on error.
+	bool Started(AsyncIO& IO, const BOOL Result) {
+		IO._Pending = Result || GetLastError() == ERROR_IO_PENDING;
+		return !IO._Pending;
+	}
+
+	// Return the index entry of a block.
+	template <typename HeaderType>
+	[[nodiscard]] static IndexEntry Entry(const uint64 Offset, const HeaderType& Header) {
+		IndexEntry entry{Offset, Header.Size, 0, Header.Ident};
+		if constexpr (sizeof HeaderType >= sizeof BlockHeader + sizeof entry.Count)
+			memcpy(&entry.Count, (const uint8*)&Header + sizeof BlockHeader, sizeof entry.Count);
+		return entry;
+	}
+
+	// Add a block to the index, if the index covers every block.
+	void AddEntry(const IndexEntry& Entry) {
+		auto sync = lock_guard<mutex>(_IndexLock);
+		if (!_Indexed)
+			return;
+
+		// Blocks arrive almost in order of their offsets.
+		const auto pos = upper_bound(_Index.begin(), _Index.end(), Entry.Offset,
+			[](const uint64 Offset, const IndexEntry& Other) { return Offset < Other.Offset; });
+		_Index.insert(pos, Entry);
+	}
+
+	// Return the offset of the end of the indexed blocks.
+	[[nodiscard]] inline uint64 IndexEnd() const {
+		return _Index.empty() ? sizeof FileHeader : _Index.back().Offset + _Index.back().Size;
+	}
+
+	// Return the entries of every block, indexing the file if needed.
+	// The stream position is preserved.
+	const vector<IndexEntry>& Blocks() {
+		if (!_Indexed) {
+			const auto pos = _File.tellg();
+			SeekTail();
+			_File.clear();
+			_File.seekg(pos);
+		}
+
+		return _Index;
+	}
+
+	// Load the index from the end of the file, if it has one.
+	// Returns true if none was found.
+	bool LoadIndex() {
+		_Index.clear();
+		_Indexed = false;
+
+		IndexTrailer trailer;
+		IndexHeader hdr;
+		_File.clear();
+		_File.seekg(-streamoff(sizeof trailer), ios_base::end);
+		if (!_File.fail() && !Read(trailer) && trailer.Magic == IndexMagic) {
+			_File.seekg(streamoff(trailer.Offset));
+			if (!ReadHeader(hdr)) {
+				_Index.resize(hdr.Count);
+				_Indexed = !Read(_Index.data(), _Index.size()) && IndexEnd() == trailer.Offset;
+			}
+		}
+
+		if (!_Indexed)
+			_Index.clear();
+
+		_File.clear();
+		return !_Indexed;
+	}
+
+	// Write the index and its trailer after the last block, and end the file there.
+	// Returns true on error.
+	bool WriteIndex() {
+		const auto end = IndexEnd();
+		const IndexHeader hdr(uint32(_Index.size()));
+		const IndexTrailer trailer{end};
+
+		_File.clear();
+		_File.seekp(streamoff(end));
+		if (Write(hdr) || Write(_Index.data(), _Index.size()) || Write(trailer))
+			return true;
+
+		_File.flush();
+		return _File.fail() || Truncate(end + hdr.Size);
+	}
+
+	// End the file at the supplied size.
+	// Returns true on error.
+	bool Truncate(const uint64 Size) {
+		_File.flush();
+
+		FILE_END_OF_FILE_INFO info{};
+		info.EndOfFile.QuadPart = int64(Size);
+		return !SetFileInformationByHandle(_Handle, FileEndOfFileInfo, &info, sizeof info);
+	}
+
 	// Seek to the beginning of the beginning of the file.
 	// Returns true on error.
 	bool Rewind() {
@@ -142,6 +481,23 @@ struct DataStream {
 	// Returns true on error.
 	bool Seek(const uint16 Ident) {
 		assert(_File.is_open());
+
+		// Jump to the next indexed block from here.
+		if (_Indexed) {
+			const auto pos = _File.tellg();
+			if (_File.fail())
+				return true;
+
+			auto entry = lower_bound(_Index.begin(), _Index.end(), uint64(streamoff(pos)),
+				[](const IndexEntry& Entry, const uint64 Offset) { return Entry.Offset < Offset; });
+			for (; entry != _Index.end(); entry++)
+				if (entry->Ident == Ident) {
+					_File.seekg(streamoff(entry->Offset));
+					return _File.fail();
+				}
+
+			return true;
+		}
 		
 		// Read blocks until a matching identity tag is found.
 		for (BlockHeader hdr;;) {
@@ -173,35 +529,53 @@ struct DataStream {
 	// Returns true on error.
 	bool SeekTail() {
 		assert(_File.is_open());
+
+		// The index knows where the blocks end.
+		if (_Indexed) {
+			_File.clear();
+			_File.seekg(streamoff(IndexEnd()));
+			return _File.fail();
+		}
 		
 		// To find the end, we must start from the beginning.
 		if (Rewind())
 			return true;
 
-		// Read all blocks until the end is reached.
+		// Read all blocks until the end is reached, indexing them on the way.
+		vector<IndexEntry> index;
 		for (BlockHeader hdr;;) {
 			// Remember where we are now. This could be the end.
 			const auto pos = _File.tellg();
 			if (_File.fail())
 				return true;
 
-			// Read and validate this block header.
-			if (ReadHeader(hdr)) {
+			// Read and validate this block header, and the first word of its user header.
+			IndexEntry entry{};
+			if (ReadHeader(hdr) ||
+				(hdr.Size >= sizeof BlockHeader + sizeof entry.Count && Read(entry.Count))) {
 				// If the read failed, this is the end.
-				_File.seekg(pos);
-				_File.clear();
-				return false;
+				break;
 			}
 
+			entry = {uint64(streamoff(pos)), hdr.Size, entry.Count, hdr.Ident};
+
 			// Seek to the next block.
 			_File.seekg(pos + streamoff(hdr.Size));
 			if (_File.fail() || _File.eof()) {
 				// If the seek failed, this is the end.
-				_File.seekg(pos);
-				_File.clear();
-				return false;
+				break;
 			}
+
+			if (hdr.Ident != IndexIdent)
+				index.push_back(entry);
 		}
+
+		// Every block up to here is now indexed.
+		_File.clear();
+		_File.seekg(streamoff(index.empty() ? sizeof FileHeader : index.back().Offset + index.back().Size));
+		_Index   = move(index);
+		_Indexed = true;
+		return _File.fail();
 	}
 
 	// Write an object to file.
@@ -254,6 +628,7 @@ struct DataStream {
 	// Returns true on error.
 	template <typename HeaderType>
 	bool WriteHeader(HeaderType&& Header) {
+		AddEntry(Entry(uint64(streamoff(_File.tellp())), Header));
 		return Write(forward<HeaderType>(Header));
 	}
 
@@ -267,4 +642,170 @@ struct DataStream {
 
 
 // Expose the basic block header (when a user header is not required).
-using BlockHeader = DataStream::BlockHeader;
\ No newline at end of file
+using BlockHeader = DataStream::BlockHeader;
+using IndexEntry  = DataStream::IndexEntry;
+
+// Divide blocks into contiguous parts holding roughly equal numbers of records.
+// Returns the index of the first block of each part, followed by the number of blocks.
+inline vector<size_t> Partition(const vector<IndexEntry>& Blocks, const size_t Parts) {
+	uint64 total = 0;
+	for (const auto& block : Blocks)
+		total += block.Count;
+
+	vector<size_t> bounds{0};
+	uint64 records = 0;
+	for (size_t block = 0; block < Blocks.size() && bounds.size() < Parts; block++) {
+		records += Blocks[block].Count;
+		if (records * Parts >= total * bounds.size())
+			bounds.push_back(block + 1);
+	}
+
+	bounds.resize(Parts, Blocks.size());
+	bounds.push_back(Blocks.size());
+	return bounds;
+}
+
+
+// Memory-Mapped Data Stream ==============================
+// A read-only view of a whole data stream file, mapped into
+// memory. Blocks are visited in place, by offset, so any
+// number of threads may walk the same mapping at once, each
+// with a cursor of its own, without locks or copies. Pages
+// are prefetched in a window ahead of each reader.
+
+
+struct MappedStream {
+	using FileHeader = DataStream::FileHeader;
+
+	static constexpr uint64 Window = 1ULL << 26;	// Bytes prefetched ahead of a reader.
+
+	HANDLE		 _File    = INVALID_HANDLE_VALUE;	// File handle
+	HANDLE		 _Mapping = nullptr;				// File mapping object
+	const uint8* _Data    = nullptr;				// View of the whole file
+	uint64		 _Size    = 0;						// File size in bytes
+
+	MappedStream() = default;
+	MappedStream(const MappedStream&) = delete;
+
+	~MappedStream() {
+		Close();
+	}
+
+	// Map an existing file, read-only.
+	// Returns true on error.
+	bool Open(const path& Filename) {
+		assert(Filename.has_filename() && !_Data);
+
+		// The file is read front to back, so ask the cache for sequential read-ahead.
+		_File = CreateFileW(Filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		LARGE_INTEGER size;
+		if (_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(_File, &size) ||
+			uint64(size.QuadPart) < sizeof FileHeader)
+			return true;
+
+		_Size    = uint64(size.QuadPart);
+		_Mapping = CreateFileMappingW(_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!_Mapping)
+			return true;
+
+		_Data = (const uint8*)MapViewOfFile(_Mapping, FILE_MAP_READ, 0, 0, 0);
+		return !_Data || ((const FileHeader*)_Data)->Validate();
+	}
+
+	// Unmap and close the file, if open.
+	void Close() {
+		if (_Data)
+			UnmapViewOfFile(_Data);
+		if (_Mapping)
+			CloseHandle(_Mapping);
+		if (_File != INVALID_HANDLE_VALUE)
+			CloseHandle(_File);
+
+		_Data    = nullptr;
+		_Mapping = nullptr;
+		_File    = INVALID_HANDLE_VALUE;
+		_Size    = 0;
+	}
+
+	// Return the offset of the first block, following the file header.
+	[[nodiscard]] static constexpr uint64 Begin() {
+		return sizeof FileHeader;
+	}
+
+	// Return the block at an offset, or null if it is invalid or truncated.
+	const BlockHeader* At(const uint64 Offset) const {
+		if (Offset + sizeof BlockHeader > _Size)
+			return nullptr;
+
+		const auto* hdr = (const BlockHeader*)(_Data + Offset);
+		if (hdr->Validate() || hdr->Size < sizeof BlockHeader || hdr->Size > _Size - Offset)
+			return nullptr;
+
+		return hdr;
+	}
+
+	// Return the entries of the blocks bearing any of several identity tags,
+	// from the index at the end of the file, or by walking the blocks without one.
+	vector<IndexEntry> Blocks(const initializer_list<uint16> Idents) const {
+		const auto match = [&](const uint16 Ident) {
+			return find(Idents.begin(), Idents.end(), Ident) != Idents.end();
+		};
+
+		vector<IndexEntry> blocks;
+		DataStream::IndexTrailer trailer;
+		DataStream::IndexHeader  index;
+		if (_Size >= Begin() + sizeof trailer) {
+			memcpy(&trailer, _Data + _Size - sizeof trailer, sizeof trailer);
+			if (trailer.Magic == DataStream::IndexMagic && trailer.Offset + sizeof index <= _Size) {
+				memcpy(&index, _Data + trailer.Offset, sizeof index);
+				if (!index.Validate() && trailer.Offset + index.Size == _Size) {
+					const auto* entries = _Data + trailer.Offset + sizeof index;
+					for (uint32 i = 0; i < index.Count; i++) {
+						IndexEntry entry;
+						memcpy(&entry, entries + sizeof entry * i, sizeof entry);
+						if (match(entry.Ident))
+							blocks.push_back(entry);
+					}
+
+					return blocks;
+				}
+			}
+		}
+
+		for (auto cursor = Begin(); const auto* block = At(cursor); cursor += block->Size) {
+			if (!match(block->Ident))
+				continue;
+
+			IndexEntry entry{cursor, block->Size, 0, block->Ident};
+			if (block->Size >= sizeof BlockHeader + sizeof entry.Count)
+				memcpy(&entry.Count, block + 1, sizeof entry.Count);
+			blocks.push_back(entry);
+		}
+
+		return blocks;
+	}
+
+	// Find the next block bearing any of several identity tags, from the
+	// cursor offset, and advance the cursor past it. Returns null when no
+	// such block remains. An invalid or truncated block ends the stream.
+	const BlockHeader* Next(uint64& Cursor, const initializer_list<uint16> Idents) const {
+		for (const BlockHeader* hdr; (hdr = At(Cursor));) {
+			Cursor += hdr->Size;
+			if (find(Idents.begin(), Idents.end(), hdr->Ident) != Idents.end())
+				return hdr;
+		}
+
+		return nullptr;
+	}
+
+	// Hint that a range of the file will be read soon.
+	void Prefetch(const uint64 Offset, const uint64 Bytes) const {
+		if (Offset >= _Size)
+			return;
+
+		WIN32_MEMORY_RANGE_ENTRY range{(void*)(_Data + Offset), size_t(min(Bytes, _Size - Offset))};
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+};
\ No newline at end of file
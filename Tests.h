@@ -0,0 +1,188 @@
+#pragma once
+
+
+// Self-Checks ============================================
+// Quick checks of the parts whose fast paths must agree
+// exactly with a plain reference, run by StaticRay --test.
+// Each check reports what it found, and returns true when
+// it failed.
+
+
+// Random Streams
+// Every stream must continue its Random128 generator, value for
+// value, whether filled in AVX2 registers or one at a time.
+inline bool CheckRandomStreams() {
+	constexpr auto Streams = RandomStreams::Streams;
+	constexpr size_t Count = Streams * 64;
+
+	bool failed = false;
+	for (const bool wide : {false, true}) {
+		if (wide && !CPU.AVX2)
+			continue;
+
+		// Fill values, then Reals, from the same streams.
+		RandomStreams streams(Random128(0xC0FFEE));
+		array<Random128, Streams> reference;
+		for (uint32 stream = 0; stream < Streams; stream++)
+			reference[stream] = streams.Stream(stream);
+
+		vector<uint64> values(Count);
+		vector<Real>   reals(Count);
+		streams.Fill(values.data(), Count, wide);
+		streams.Fill(reals.data(), Count, wide);
+
+		size_t errors = 0;
+		for (size_t value = 0; value < Count; value++)
+			errors += values[value] != reference[value % Streams]();
+		for (size_t value = 0; value < Count; value += 2) {
+			const auto bits = reference[(value / 2) % Streams]();
+			errors += reals[value    ] != Real(uint32(bits      ) >> 8) * 0x1p-24r;
+			errors += reals[value + 1] != Real(uint32(bits >> 32) >> 8) * 0x1p-24r;
+		}
+		for (uint32 stream = 0; stream < Streams; stream++)
+			errors += streams.Stream(stream).State != reference[stream].State;
+
+		cout << format("Random streams ({}): {} mismatches.", wide ? "AVX2" : "scalar", errors) << endl;
+		failed |= errors != 0;
+	}
+
+	return failed;
+}
+
+// Hit Record Codec
+// Packing must restore every record, in position order. Records
+// of random bytes leave their planes stored, while records of
+// small values have every plane entropy coded. A packed block
+// cut short must be rejected.
+template <typename HitType>
+bool CheckHitCodec() {
+	constexpr auto Words = sizeof HitType / sizeof uint16;
+	static_assert(sizeof HitType % sizeof uint16 == 0);
+
+	const auto before = [](const HitType& A, const HitType& B) {
+		return memcmp(&A, &B, sizeof HitType) < 0;
+	};
+
+	HitCodec<HitType> codec;
+	Random128 rng(0xC0DEC);
+	bool failed = false;
+	for (const uint32 count : {0u, 1u, 1000u, 65536u})
+		for (const uint16 range : {uint16(0), uint16(64)}) {
+			// Generate the records, a word at a time.
+			vector<HitType> hits(count);
+			for (auto& hit : hits) {
+				array<uint16, Words> words;
+				for (auto& word : words)
+					word = range ? uint16(rng() % range) : uint16(rng());
+				memcpy(&hit, words.data(), sizeof hit);
+			}
+
+			vector<uint8> packed;
+			codec.Pack(hits.data(), count, packed);
+
+			vector<HitType> unpacked(count);
+			auto errors = size_t(codec.Unpack(packed.data(), packed.size(), unpacked.data(), count));
+
+			sort(hits.begin(), hits.end(), before);
+			sort(unpacked.begin(), unpacked.end(), before);
+			for (uint32 index = 0; index < count; index++)
+				errors += memcmp(&hits[index], &unpacked[index], sizeof HitType) != 0;
+
+			if (!packed.empty())
+				errors += !codec.Unpack(packed.data(), packed.size() - 1, unpacked.data(), count);
+
+			cout << format("Hit codec ({} records of {}): {} bytes packed, {} mismatches.",
+				count, range ? "small values" : "random bytes", packed.size(), errors) << endl;
+			failed |= errors != 0;
+		}
+
+	return failed;
+}
+
+// Partition
+// Parts must be contiguous and cover every block in order, with
+// no part holding more than its share of records plus one block.
+inline bool CheckPartition() {
+	Random128 rng(0xB10C5);
+	size_t cases = 0, errors = 0;
+	for (const size_t blockCount : {size_t(0), size_t(1), size_t(7), size_t(1000)})
+		for (size_t parts = 1; parts <= 16; parts++, cases++) {
+			vector<IndexEntry> blocks(blockCount);
+			uint64 total = 0, largest = 0;
+			for (auto& block : blocks) {
+				block.Count = uint32(rng() % 4096);
+				total  += block.Count;
+				largest = max(largest, uint64(block.Count));
+			}
+
+			const auto bounds = Partition(blocks, parts);
+			if (bounds.size() != parts + 1 || bounds.front() != 0 || bounds.back() != blockCount) {
+				errors++;
+				continue;
+			}
+
+			for (size_t part = 0; part < parts; part++) {
+				if (bounds[part] > bounds[part + 1]) {
+					errors++;
+					break;
+				}
+
+				uint64 records = 0;
+				for (auto block = bounds[part]; block < bounds[part + 1]; block++)
+					records += blocks[block].Count;
+				errors += records * parts > total + largest * parts;
+			}
+		}
+
+	cout << format("Partition ({} cases): {} mismatches.", cases, errors) << endl;
+	return errors != 0;
+}
+
+// Photon Development
+// Frames developed in SIMD lanes must match those developed a
+// photon at a time, pixel for pixel, as must their brightness.
+template <typename HitType>
+bool CheckDevelop() {
+	constexpr uint32 Size = 64;
+	const auto radius = 0.5r, focalLen = 1r, limit = 0.6r;
+	const auto center = RVector{Size, Size} / 2r;
+	const auto scale  = center * radius * focalLen * csqrt(2r) / -2r;
+	const vector<Real> distances{2r, 1.5r, 1.2r};
+
+	// Photons arriving from within 60 degrees of the lens axis.
+	Random128 rng(0xF11A);
+	const auto uniform = [&]() { return Real(rng() >> 40) * 0x1p-23r - 1r; };
+	vector<HitType> hits(5000);
+	for (auto& hit : hits) {
+		const auto color = RColor(uniform() + 1r, uniform() + 1r, uniform() + 1r, 0) * 4r;
+		hit = HitType(uniform(), uniform(), uniform() * 0.6r, uniform() * 0.6r, color);
+	}
+
+	vector<RImage> scalar, lanes;
+	for (size_t frame = 0; frame < distances.size(); frame++) {
+		scalar.emplace_back(Coord{Size, Size});
+		lanes .emplace_back(Coord{Size, Size});
+	}
+
+	float64 scalarBright = 0, lanesBright = 0;
+	DevelopScalar(span<const HitType>(hits), scalar, distances, radius, focalLen, limit, scale, center, scalarBright);
+
+	const auto photons = make_unique<DevelopBatch<>>();
+	for (size_t offset = 0; offset < hits.size(); offset += photons->Size) {
+		const auto records = uint32(min(hits.size() - offset, size_t(photons->Size)));
+		photons->Load(&hits[offset], records, radius, focalLen, limit, lanesBright);
+		for (size_t frame = 0; frame < distances.size(); frame++)
+			photons->Expose(lanes[frame], distances[frame], scale, center);
+	}
+
+	size_t errors = scalarBright != lanesBright, lit = 0;
+	for (size_t frame = 0; frame < distances.size(); frame++)
+		for (size_t pixel = 0; pixel < scalar[frame].size(); pixel++) {
+			errors += memcmp(&scalar[frame][pixel], &lanes[frame][pixel], sizeof RColor) != 0;
+			lit += scalar[frame][pixel].Max() > 0r;
+		}
+
+	cout << format("Develop ({} lanes, {} pixels lit): {} mismatches.",
+		CPU.AVX512 ? 16 : CPU.AVX2 ? 8 : 1, lit, errors) << endl;
+	return errors != 0;
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+
+// Processor Topology =====================================
+// Discovers the logical processors of the system, with the
+// physical core and NUMA node of each. Workers are placed
+// on processors so that they spread across nodes and cores
+// before doubling up on SMT siblings, and may be pinned to
+// them. Each worker then allocates its memory on its node,
+// so film buffers and images never cross the interconnect.
+
+
+// SMT Policies
+// Decide whether workers share physical cores.
+enum class SmtPolicy {
+	Siblings,	// One worker per logical processor.
+	Cores,		// One worker per physical core, leaving its siblings idle.
+};
+
+// A Logical Processor
+struct LogicalProcessor {
+	uint16	Group	= 0;	// Processor group.
+	uint8	Number	= 0;	// Number within the group.
+	uint8	Sibling	= 0;	// Index among the logical processors of its core.
+	uint32	Core	= 0;	// Physical core index.
+	uint32	Node	= 0;	// NUMA node number.
+};
+
+struct CpuTopology {
+	vector<LogicalProcessor> Processors;	// Every logical processor, by core.
+	uint32	Cores = 0;						// Number of physical cores.
+	uint32	Nodes = 0;						// Number of NUMA nodes.
+
+	// Discover the topology of the system.
+	// Returns true on error.
+	bool Discover() {
+		// Query the processor cores and NUMA nodes.
+		DWORD length = 0;
+		GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+		vector<uint8> buffer(length);
+		if (!length || !GetLogicalProcessorInformationEx(RelationAll,
+			(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer.data(), &length))
+			return true;
+
+		// List the logical processors of each core, and the group masks of each node.
+		vector<pair<GROUP_AFFINITY, uint32>> nodes;
+		Processors.clear();
+		Cores = Nodes = 0;
+		for (DWORD offset = 0; offset < length;) {
+			const auto& info = *(PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)&buffer[offset];
+			offset += info.Size;
+
+			if (info.Relationship == RelationNumaNode) {
+				nodes.push_back({info.NumaNode.GroupMask, info.NumaNode.NodeNumber});
+				Nodes = max(Nodes, uint32(info.NumaNode.NodeNumber) + 1);
+				continue;
+			}
+
+			if (info.Relationship != RelationProcessorCore)
+				continue;
+
+			uint8 sibling = 0;
+			for (WORD group = 0; group < info.Processor.GroupCount; group++) {
+				const auto& mask = info.Processor.GroupMask[group];
+				for (uint8 number = 0; number < numeric_limits<KAFFINITY>::digits; number++)
+					if (mask.Mask & (KAFFINITY(1) << number))
+						Processors.push_back({mask.Group, number, sibling++, Cores});
+			}
+
+			Cores++;
+		}
+
+		// Assign each processor to the node whose mask contains it.
+		for (auto& processor : Processors)
+			for (const auto& [mask, node] : nodes)
+				if (mask.Group == processor.Group && (mask.Mask & (KAFFINITY(1) << processor.Number)))
+					processor.Node = node;
+
+		Nodes = max(Nodes, 1u);
+		return Processors.empty();
+	}
+
+	// Return the processors to place workers on, in order of assignment.
+	// Nodes take turns, and every core is used once before any sibling.
+	vector<LogicalProcessor> Placement(const SmtPolicy Policy) const {
+		vector<LogicalProcessor> processors;
+		for (const auto& processor : Processors)
+			if (Policy == SmtPolicy::Siblings || !processor.Sibling)
+				processors.push_back(processor);
+
+		// Rank each processor among those of its node and sibling index.
+		sort(processors.begin(), processors.end(), [](const auto& A, const auto& B) {
+			return tie(A.Sibling, A.Node, A.Core) < tie(B.Sibling, B.Node, B.Core);
+		});
+
+		vector<pair<uint32, LogicalProcessor>> ranked;
+		for (size_t index = 0; index < processors.size(); index++) {
+			const auto& processor = processors[index];
+			const auto same = index && processors[index - 1].Sibling == processor.Sibling &&
+				processors[index - 1].Node == processor.Node;
+			ranked.push_back({same ? ranked.back().first + 1 : 0, processor});
+		}
+
+		// Interleave the nodes by rank.
+		stable_sort(ranked.begin(), ranked.end(), [](const auto& A, const auto& B) {
+			return tie(A.second.Sibling, A.first) < tie(B.second.Sibling, B.first);
+		});
+
+		for (size_t index = 0; index < ranked.size(); index++)
+			processors[index] = ranked[index].second;
+
+		return processors;
+	}
+};
+
+
+// Worker Placement =======================================
+
+
+struct WorkerPlacement {
+	vector<LogicalProcessor> Processors;	// Processor of each worker.
+	bool	Pin = false;					// Pin workers to their processors.
+	string	Summary;						// Description of the topology and placement.
+
+	WorkerPlacement() = default;
+
+	// Place one worker on each processor allowed by the policy, or on the
+	// first Limit of them in order of assignment, when it is nonzero.
+	// Without a known topology, one unpinned worker is placed per hardware thread.
+	WorkerPlacement(const SmtPolicy Policy, const bool Pin, const uint32 Limit = 0) : Pin(Pin) {
+		CpuTopology topology;
+		if (topology.Discover()) {
+			const auto threads = max(thread::hardware_concurrency(), 1u);
+			Processors.resize(Limit ? min(Limit, threads) : threads);
+			this->Pin = false;
+			Summary = format("Topology unknown. {} workers, unpinned.", Processors.size());
+			return;
+		}
+
+		Processors = topology.Placement(Policy);
+		if (Limit && Limit < Processors.size())
+			Processors.resize(Limit);
+
+		Summary = format("Topology: {} nodes, {} cores, {} logical processors. {} workers, {}, {}.",
+			topology.Nodes, topology.Cores, topology.Processors.size(), Processors.size(),
+			Policy == SmtPolicy::Cores ? "one per core" : "one per logical processor",
+			Pin ? "pinned" : "unpinned");
+	}
+
+	// Return the number of workers.
+	[[nodiscard]] inline uint32 Workers() const {
+		return uint32(Processors.size());
+	}
+
+	// Return the NUMA node of a worker.
+	[[nodiscard]] inline uint32 Node(const size_t Worker) const {
+		return Processors[Worker].Node;
+	}
+
+	// Return the number of NUMA nodes workers are placed on.
+	[[nodiscard]] inline uint32 Nodes() const {
+		uint32 nodes = 1;
+		for (const auto& processor : Processors)
+			nodes = max(nodes, processor.Node + 1);
+		return nodes;
+	}
+
+	// Pin the calling thread to the worker's processor, when pinning.
+	// Returns true on error.
+	bool Enter(const size_t Worker) const {
+		if (!Pin)
+			return false;
+
+		GROUP_AFFINITY affinity{};
+		affinity.Group = Processors[Worker].Group;
+		affinity.Mask  = KAFFINITY(1) << Processors[Worker].Number;
+		return !SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+	}
+};
+
+
+// Node-Local Allocation ==================================
+// Objects are allocated in whole pages on the memory of a
+// preferred NUMA node, falling back to any node.
+
+
+template <typename Type>
+struct NodeDeleter {
+	void operator() (Type* Object) const {
+		Object->~Type();
+		VirtualFree(Object, 0, MEM_RELEASE);
+	}
+};
+
+template <typename Type>
+using NodeLocal = unique_ptr<Type, NodeDeleter<Type>>;
+
+// Construct an object on the memory of the node.
+// Returns null on error.
+template <typename Type, typename... ArgTypes>
+NodeLocal<Type> MakeNodeLocal(const uint32 Node, ArgTypes&&... Args) {
+	auto* memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, sizeof Type,
+		MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, Node);
+	if (!memory)
+		memory = VirtualAlloc(nullptr, sizeof Type, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+	return NodeLocal<Type>(memory ? new (memory) Type(forward<ArgTypes>(Args)...) : nullptr);
+}
\ No newline at end of file
@@ -42,4 +42,22 @@ static constexpr Real operator""r(unsigned long long int Value) noexcept {
 
 
 constexpr Real Epsilon  = 0x1p-22r;
-constexpr Real Infinity = INFINITY;
\ No newline at end of file
+constexpr Real Infinity = INFINITY;
+
+// Assumed size of a cache line, in bytes.
+constexpr size_t CacheLine = 64;
+
+
+// Compile-Time Strings ===================================
+
+
+// A string literal usable as a template argument.
+template <size_t Length>
+struct FixedString {
+	char	Chars[Length] = {};
+
+	constexpr FixedString(const char (&String)[Length]) {
+		for (size_t i = 0; i < Length; i++)
+			Chars[i] = String[i];
+	}
+};
\ No newline at end of file
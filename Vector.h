@@ -118,11 +118,11 @@ template <typename Type>
 #define ComponentAccess													\
 	InlineND Type operator[] (const size_t Index) {						\
 		assert(Index < 4);												\
-		return (Type*)(this)[Index];									\
+		return ((Type*)this)[Index];									\
 	}																	\
 	InlineNDC Type operator[] (const size_t Index) const {				\
 		assert(Index < 4);												\
-		return (Type*)(this)[Index];									\
+		return ((Type*)this)[Index];									\
 	}
 
 // Unary Operator Implementation
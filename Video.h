@@ -0,0 +1,575 @@
+#pragma once
+
+
+// Video Output ===========================================
+// Streams developed frames into a single video file. Frames
+// finish out of order across threads, so each is encoded by
+// the thread that developed it, and then waits in a small
+// reorder buffer until the frames before it are in. Frames
+// are appended in order as soon as they can be. Videos are
+// uncompressed YUV4MPEG2, or AVI holding uncompressed RGB or
+// Motion-JPEG frames. All keep the orientation of the image
+// files, as seen through the lens.
+
+
+// Video Formats
+enum class VideoFormat {
+	None,		// No video. Frames are written to image files.
+	Y4m,		// YUV4MPEG2, 4:4:4 studio range BT.601.
+	Avi,		// AVI of uncompressed 24bit RGB frames.
+	Mjpeg,		// AVI of Motion-JPEG frames.
+};
+
+// Return the file name extension of a video format.
+[[nodiscard]] constexpr string_view Extension(const VideoFormat Format) {
+	return Format == VideoFormat::Y4m ? "y4m" : "avi";
+}
+
+
+// Baseline JPEG Encoder ==================================
+// Encodes 8bit RGB frames as baseline JFIF (ITU T.81) with
+// the example tables of its Annex K, without subsampling the
+// chroma. Quality from 1 to 100 scales the quantization
+// tables as the IJG library does. Tables are built once, so
+// one encoder may be shared by several threads.
+
+
+struct JpegEncoder {
+	// Zig-zag order of the coefficients of a block, by their natural index.
+	static constexpr array<uint8, 64> ZigZag = {
+		 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+	};
+
+	// Quantization of luminance and chrominance, in natural order.
+	static constexpr array<uint8, 64> Quantization[2] = {{
+		16, 11, 10, 16, 24, 40, 51, 61,		12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56,		14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68,109,103, 77,		24, 35, 55, 64, 81,104,113, 92,
+		49, 64, 78, 87,103,121,120,101,		72, 92, 95, 98,112,100,103, 99,
+	}, {
+		17, 18, 24, 47, 99, 99, 99, 99,		18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99,		47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,		99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99,		99, 99, 99, 99, 99, 99, 99, 99,
+	}};
+
+	// Huffman tables, as stored: the count of codes of each length from 1 to 16,
+	// then the symbols in order of their codes. DC and AC of luminance, then chrominance.
+	static constexpr uint8 DcLuma[] = {
+		0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+	};
+	static constexpr uint8 AcLuma[] = {
+		0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7D,
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+		0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xA1, 0x08, 0x23, 0x42, 0xB1, 0xC1, 0x15, 0x52, 0xD1, 0xF0,
+		0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0A, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x25, 0x26, 0x27, 0x28,
+		0x29, 0x2A, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+		0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+		0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+		0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7,
+		0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3, 0xC4, 0xC5,
+		0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xE1, 0xE2,
+		0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+		0xF9, 0xFA,
+	};
+	static constexpr uint8 DcChroma[] = {
+		0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+		0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+	};
+	static constexpr uint8 AcChroma[] = {
+		0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+		0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xA1, 0xB1, 0xC1, 0x09, 0x23, 0x33, 0x52, 0xF0,
+		0x15, 0x62, 0x72, 0xD1, 0x0A, 0x16, 0x24, 0x34, 0xE1, 0x25, 0xF1, 0x17, 0x18, 0x19, 0x1A, 0x26,
+		0x27, 0x28, 0x29, 0x2A, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+		0x49, 0x4A, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+		0x69, 0x6A, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+		0x88, 0x89, 0x8A, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0xA2, 0xA3, 0xA4, 0xA5,
+		0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xC2, 0xC3,
+		0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA,
+		0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8,
+		0xF9, 0xFA,
+	};
+
+	// Huffman Codes of a Table, by Symbol
+	struct CodeTable {
+		array<uint16, 256>	Codes{};
+		array<uint8, 256>	Lengths{};
+
+		CodeTable() = default;
+
+		// Assign codes of each length in turn, counting up (Annex C).
+		CodeTable(const span<const uint8> Stored) {
+			uint32 code = 0, symbol = 16;
+			for (uint32 length = 1; length <= 16; length++, code <<= 1)
+				for (uint32 count = Stored[length - 1]; count--; code++) {
+					Codes  [Stored[symbol]] = uint16(code);
+					Lengths[Stored[symbol]] = uint8(length);
+					symbol++;
+				}
+		}
+	};
+
+	array<uint8, 64>	_Quant[2];		// Scaled quantization, in zig-zag order.
+	array<float32, 64>	_Divisors[2];	// Reciprocals of the scaled quantization, in natural order.
+	array<float32, 64>	_Cosines;		// DCT basis: C(u) / 2 * cos((2x + 1) * u * pi / 16) at [u * 8 + x].
+	CodeTable			_Tables[4];		// DC and AC codes of luminance, then chrominance.
+
+	JpegEncoder(const uint32 Quality = 90) {
+		const auto scale = Quality < 50 ? 5000 / max(Quality, 1u) : 200 - 2 * min(Quality, 100u);
+		for (uint32 table = 0; table < 2; table++)
+			for (uint32 index = 0; index < 64; index++) {
+				const auto quant = clamp((Quantization[table][ZigZag[index]] * scale + 50) / 100, 1u, 255u);
+				_Quant[table][index] = uint8(quant);
+				_Divisors[table][ZigZag[index]] = 1r / quant;
+			}
+
+		for (uint32 u = 0; u < 8; u++)
+			for (uint32 x = 0; x < 8; x++)
+				_Cosines[u * 8 + x] = float32((u ? 0.5 : 0.5 / numbers::sqrt2) * cos((2 * x + 1) * u * numbers::pi / 16));
+
+		_Tables[0] = CodeTable(DcLuma);
+		_Tables[1] = CodeTable(AcLuma);
+		_Tables[2] = CodeTable(DcChroma);
+		_Tables[3] = CodeTable(AcChroma);
+	}
+
+	// Encode a frame of 8bit blue, green, red pixels, stored top to bottom,
+	// appending the JPEG file to Output.
+	void Encode(const uint8* const Pixels, const uint32 Width, const uint32 Height, vector<uint8>& Output) const {
+		assert(Width && Height && Width < 65536 && Height < 65536);
+
+		// Append a marker segment, its length counting itself.
+		const auto segment = [&](const uint8 Marker, const initializer_list<span<const uint8>> Parts) {
+			size_t length = 2;
+			for (const auto& part : Parts)
+				length += part.size();
+
+			Output.insert(Output.end(), {0xFF, Marker, uint8(length >> 8), uint8(length)});
+			for (const auto& part : Parts)
+				Output.insert(Output.end(), part.begin(), part.end());
+		};
+
+		const uint8 jfif[] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+		const uint8 luma[] = {0}, chroma[] = {1}, dcLuma[] = {0x00}, acLuma[] = {0x10}, dcChroma[] = {0x01}, acChroma[] = {0x11};
+		const uint8 frame[] = {8, uint8(Height >> 8), uint8(Height), uint8(Width >> 8), uint8(Width),
+			3, 1, 0x11, 0, 2, 0x11, 1, 3, 0x11, 1};
+		const uint8 scan[]  = {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+
+		Output.insert(Output.end(), {0xFF, 0xD8});
+		segment(0xE0, {jfif});
+		segment(0xDB, {luma, _Quant[0], chroma, _Quant[1]});
+		segment(0xC0, {frame});
+		segment(0xC4, {dcLuma, DcLuma, acLuma, AcLuma, dcChroma, DcChroma, acChroma, AcChroma});
+		segment(0xDA, {scan});
+
+		// Entropy coded data, with bytes of 0xFF stuffed by a zero.
+		uint32 bits = 0, count = 0;
+		const auto put = [&](const uint32 Code, const uint32 Length) {
+			bits   = (bits << Length) | Code;
+			count += Length;
+			for (; count >= 8; count -= 8) {
+				const auto byte = uint8(bits >> (count - 8));
+				Output.push_back(byte);
+				if (byte == 0xFF)
+					Output.push_back(0);
+			}
+		};
+
+		// Each unit codes a block of each component, which are not subsampled.
+		int32 dc[3] = {};
+		array<float32, 64> samples[3];
+		for (uint32 top = 0; top < Height; top += 8)
+			for (uint32 left = 0; left < Width; left += 8) {
+				// Convert the block to level shifted YCbCr, repeating the edge pixels past the frame.
+				for (uint32 y = 0; y < 8; y++)
+					for (uint32 x = 0; x < 8; x++) {
+						const auto* pixel = Pixels + (size_t(min(top + y, Height - 1)) * Width + min(left + x, Width - 1)) * 3;
+						const auto b = float32(pixel[0]), g = float32(pixel[1]), r = float32(pixel[2]);
+						samples[0][y * 8 + x] =  0.299r    * r + 0.587r    * g + 0.114r    * b - 128;
+						samples[1][y * 8 + x] = -0.168736r * r - 0.331264r * g + 0.5r      * b;
+						samples[2][y * 8 + x] =  0.5r      * r - 0.418688r * g - 0.081312r * b;
+					}
+
+				for (uint32 component = 0; component < 3; component++)
+					Block(samples[component], component ? 1 : 0, dc[component], put);
+			}
+
+		// Pad the last byte with ones, and end the image.
+		if (count)
+			put((1u << (8 - count)) - 1, 8 - count);
+		Output.insert(Output.end(), {0xFF, 0xD9});
+	}
+
+protected:
+	// Transform, quantize and code a block of level shifted samples,
+	// with the quantization and codes of a table, and the previous DC.
+	template <typename PutFunc>
+	void Block(const array<float32, 64>& Samples, const uint32 Table, int32& DC, PutFunc& Put) const {
+		// Separable DCT, over the rows and then the columns.
+		array<float32, 64> rows, coefs;
+		for (uint32 y = 0; y < 8; y++)
+			for (uint32 u = 0; u < 8; u++) {
+				float32 sum = 0;
+				for (uint32 x = 0; x < 8; x++)
+					sum += Samples[y * 8 + x] * _Cosines[u * 8 + x];
+				rows[y * 8 + u] = sum;
+			}
+
+		for (uint32 v = 0; v < 8; v++)
+			for (uint32 u = 0; u < 8; u++) {
+				float32 sum = 0;
+				for (uint32 y = 0; y < 8; y++)
+					sum += rows[y * 8 + u] * _Cosines[v * 8 + y];
+				coefs[v * 8 + u] = sum;
+			}
+
+		// Code a value by its magnitude category, then its bits (less one if negative).
+		const auto value = [&](const CodeTable& Codes, const uint32 Run, const int32 Value) {
+			const auto size = uint32(bit_width(uint32(abs(Value))));
+			const auto symbol = Run << 4 | size;
+			Put(Codes.Codes[symbol], Codes.Lengths[symbol]);
+			if (size)
+				Put(uint32(Value < 0 ? Value - 1 : Value) & ((1u << size) - 1), size);
+		};
+
+		const auto& dcCodes = _Tables[Table * 2];
+		const auto& acCodes = _Tables[Table * 2 + 1];
+		const auto& divisors = _Divisors[Table];
+
+		const auto quantized = int32(lround(coefs[0] * divisors[0]));
+		value(dcCodes, 0, quantized - DC);
+		DC = quantized;
+
+		// Code runs of zeros, 16 at most, with the nonzero coefficient ending each.
+		uint32 run = 0;
+		for (uint32 index = 1; index < 64; index++) {
+			const auto natural = ZigZag[index];
+			const auto coef = int32(lround(coefs[natural] * divisors[natural]));
+			if (!coef) {
+				run++;
+				continue;
+			}
+
+			for (; run > 15; run -= 16)
+				Put(acCodes.Codes[0xF0], acCodes.Lengths[0xF0]);
+			value(acCodes, run, coef);
+			run = 0;
+		}
+
+		// End the block early.
+		if (run)
+			Put(acCodes.Codes[0x00], acCodes.Lengths[0x00]);
+	}
+};
+
+
+// Streaming Video Writer =================================
+
+
+template <typename FileType>
+struct VideoWriter {
+#pragma pack(push, 1)
+	// RIFF Chunk and List Headers
+	struct Chunk {
+		uint32	Id, Size;
+	};
+
+	struct List {
+		uint32	Id, Size, Type;
+	};
+
+	// AVI Main Header
+	struct MainHeader {
+		uint32	MicroSecPerFrame, MaxBytesPerSec, PaddingGranularity, Flags;
+		uint32	TotalFrames, InitialFrames, Streams, SuggestedBufferSize;
+		uint32	Width, Height, Reserved[4];
+	};
+
+	// AVI Stream Header
+	struct StreamHeader {
+		uint32	Type, Handler, Flags;
+		uint16	Priority, Language;
+		uint32	InitialFrames, Scale, Rate, Start, Length;
+		uint32	SuggestedBufferSize, Quality, SampleSize;
+		int16	Frame[4];
+	};
+
+	// Bitmap Format of the Frames
+	struct BitmapHeader {
+		uint32	Size;
+		int32	Width, Height;
+		uint16	Planes, BitCount;
+		uint32	Compression, SizeImage;
+		int32	XPelsPerMeter, YPelsPerMeter;
+		uint32	ClrUsed, ClrImportant;
+	};
+
+	// AVI File Headers, up to the frames.
+	// Written when the file is opened, and again with the totals when it is closed.
+	struct AVIHeaders {
+		List			Riff, HeaderList;
+		Chunk			MainChunk;
+		MainHeader		Main;
+		List			StreamList;
+		Chunk			StreamChunk;
+		StreamHeader	Stream;
+		Chunk			FormatChunk;
+		BitmapHeader	Format;
+		List			Movie;
+	};
+
+	// AVI Index Entry
+	struct IndexEntry {
+		uint32	Id, Flags, Offset, Size;
+	};
+#pragma pack(pop)
+
+	// Return the little endian code of four characters.
+	[[nodiscard]] static constexpr uint32 FourCC(const char (&Code)[5]) {
+		return uint32(uint8(Code[0])) | uint32(uint8(Code[1])) << 8 | uint32(uint8(Code[2])) << 16 | uint32(uint8(Code[3])) << 24;
+	}
+
+	static constexpr uint32 KeyFrame = 0x10;	// Index flag of frames decoded on their own.
+	static constexpr uint32 HasIndex = 0x10;	// Main header flag of files with an index.
+
+	VideoFormat			Format = VideoFormat::None;
+	Coord				Dimensions;
+	uint32				FrameRate = 30;		// Frames per second.
+	uint32				Window = 1;			// Most frames buffered ahead of the next to be appended.
+
+	ofstream			_File;				// Output file.
+	JpegEncoder			_Jpeg;				// Motion-JPEG frame encoder.
+	mutex				_Lock;				// Guards the reorder buffer and file.
+	condition_variable	_Appended;			// Signaled when frames are appended.
+	vector<vector<uint8>> _Slots;			// Reorder buffer of encoded frames, by index modulo Window. Empty slots are vacant.
+	uint32				_Next = 0;			// Index of the next frame to be appended.
+	uint64				_Bytes = 0;			// Bytes of frames appended.
+	uint32				_Largest = 0;		// Largest frame appended.
+	vector<IndexEntry>	_Index;				// AVI index of the appended frames.
+	bool				_Failed = false;	// Did any frame fail to be appended?
+
+	VideoWriter() = default;
+	VideoWriter(const VideoWriter&) = delete;
+
+	~VideoWriter() {
+		Close();
+	}
+
+	// Create a video file, and write its headers.
+	// Returns true on error.
+	bool Open(const path& Filename, const VideoFormat Format, const Coord& Dimensions, const uint32 FrameRate, const uint32 Window) {
+		assert(Format != VideoFormat::None && !_File.is_open());
+
+		this->Format     = Format;
+		this->Dimensions = Dimensions;
+		this->FrameRate  = max(FrameRate, 1u);
+		this->Window     = max(Window, 1u);
+
+		_Slots.assign(this->Window, {});
+		_Next = 0;
+		_Bytes = 0;
+		_Largest = 0;
+		_Index.clear();
+		_Failed = false;
+
+		_File.open(Filename, ios::binary | ios::trunc);
+		if (!_File.is_open())
+			return true;
+
+		if (Format == VideoFormat::Y4m) {
+			_File << format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", Dimensions.x, Dimensions.y, this->FrameRate);
+			return _File.fail();
+		}
+
+		return WriteHeaders(false);
+	}
+
+	// Encode a frame on the calling thread, and append it once the frames before
+	// it are in, along with any frames after it then in order. Waits while the frame
+	// is too far ahead of the next to be appended for the buffer to hold it.
+	void Write(const uint32 Index, const FileType& Image) {
+		vector<uint8> frame;
+		Encode(Image, frame);
+
+		unique_lock lock(_Lock);
+		assert(Index >= _Next);
+		_Appended.wait(lock, [&] { return Index < _Next + Window; });
+		_Slots[Index % Window] = move(frame);
+
+		for (auto* slot = &_Slots[_Next % Window]; !slot->empty(); slot = &_Slots[_Next % Window]) {
+			_Failed |= Append(*slot);
+			slot->clear();
+			_Next++;
+		}
+
+		_Appended.notify_all();
+	}
+
+	// Finish and close the video file, if open. Frames still waiting
+	// for one before them are lost.
+	// Returns true on error.
+	bool Close() {
+		if (!_File.is_open())
+			return false;
+
+		for (const auto& slot : _Slots)
+			_Failed |= !slot.empty();
+
+		// Append the index of the frames, and update the headers with the totals.
+		if (Format != VideoFormat::Y4m) {
+			const auto bytes = uint32(_Index.size() * sizeof IndexEntry);
+			const Chunk chunk{FourCC("idx1"), bytes};
+			_File.write((const char*)&chunk, sizeof chunk);
+			_File.write((const char*)_Index.data(), bytes);
+			_Failed |= WriteHeaders(true);
+		}
+
+		_File.close();
+		return _Failed || _File.fail();
+	}
+
+protected:
+	// Write the AVI headers at the start of the file, with the frames so far,
+	// and their index when it is written.
+	// Returns true on error.
+	bool WriteHeaders(const bool Indexed) {
+		const auto mjpeg  = Format == VideoFormat::Mjpeg;
+		const auto width  = uint32(Dimensions.x);
+		const auto height = uint32(Dimensions.y);
+		const auto frames = uint32(_Index.size());
+		const auto movie  = sizeof(List) - offsetof(List, Type) + _Bytes;
+
+		AVIHeaders hdrs{};
+		hdrs.Riff        = {FourCC("RIFF"), 0, FourCC("AVI ")};
+		hdrs.HeaderList  = {FourCC("LIST"), uint32(offsetof(AVIHeaders, Movie) - offsetof(AVIHeaders, HeaderList.Type)), FourCC("hdrl")};
+		hdrs.MainChunk   = {FourCC("avih"), sizeof MainHeader};
+		hdrs.StreamList  = {FourCC("LIST"), uint32(offsetof(AVIHeaders, Movie) - offsetof(AVIHeaders, StreamList.Type)), FourCC("strl")};
+		hdrs.StreamChunk = {FourCC("strh"), sizeof StreamHeader};
+		hdrs.FormatChunk = {FourCC("strf"), sizeof BitmapHeader};
+		hdrs.Movie       = {FourCC("LIST"), uint32(movie), FourCC("movi")};
+
+		hdrs.Riff.Size   = uint32(sizeof hdrs - sizeof(Chunk) + _Bytes + (Indexed ? sizeof(Chunk) + sizeof(IndexEntry) * frames : 0));
+
+		hdrs.Main.MicroSecPerFrame    = 1000000 / FrameRate;
+		hdrs.Main.MaxBytesPerSec      = _Largest * FrameRate;
+		hdrs.Main.Flags               = HasIndex;
+		hdrs.Main.TotalFrames         = frames;
+		hdrs.Main.Streams             = 1;
+		hdrs.Main.SuggestedBufferSize = _Largest;
+		hdrs.Main.Width               = width;
+		hdrs.Main.Height              = height;
+
+		hdrs.Stream.Type                = FourCC("vids");
+		hdrs.Stream.Handler             = mjpeg ? FourCC("MJPG") : 0;
+		hdrs.Stream.Scale               = 1;
+		hdrs.Stream.Rate                = FrameRate;
+		hdrs.Stream.Length              = frames;
+		hdrs.Stream.SuggestedBufferSize = _Largest;
+		hdrs.Stream.Quality             = ~0u;
+		hdrs.Stream.Frame[2]            = int16(width);
+		hdrs.Stream.Frame[3]            = int16(height);
+
+		hdrs.Format.Size        = sizeof BitmapHeader;
+		hdrs.Format.Width       = int32(width);
+		hdrs.Format.Height      = int32(height);
+		hdrs.Format.Planes      = 1;
+		hdrs.Format.BitCount    = 24;
+		hdrs.Format.Compression = mjpeg ? FourCC("MJPG") : 0;
+		hdrs.Format.SizeImage   = (width * 3 + 3) / 4 * 4 * height;
+
+		const auto end = _File.tellp();
+		_File.seekp(0);
+		_File.write((const char*)&hdrs, sizeof hdrs);
+		if (end > streamoff(sizeof hdrs))
+			_File.seekp(end);
+		return _File.fail();
+	}
+
+	// Encode a frame as it is appended to the file.
+	void Encode(const FileType& Image, vector<uint8>& Output) const {
+		const auto width  = uint32(Dimensions.x);
+		const auto height = uint32(Dimensions.y);
+		assert(Image.Dimensions.x == Dimensions.x && Image.Dimensions.y == Dimensions.y);
+
+		// Return the 8bit blue, green and red of a pixel, as seen through the lens.
+		const auto pixel = [&](const uint32 x, const uint32 y) {
+			return Image.Row(y)[width - 1 - x].Color();
+		};
+
+		Output.clear();
+		if (Format == VideoFormat::Y4m) {
+			// Frame marker, then the planes of Y, Cb and Cr, each top to bottom.
+			const string_view marker = "FRAME\n";
+			Output.assign(marker.begin(), marker.end());
+			Output.resize(marker.size() + size_t(width) * height * 3);
+
+			auto* planes = Output.data() + marker.size();
+			const auto plane = size_t(width) * height;
+			for (uint32 y = 0; y < height; y++)
+				for (uint32 x = 0; x < width; x++, planes++) {
+					const auto color = pixel(x, y);
+					const auto b = int32(color & 0xFF), g = int32(color >> 8 & 0xFF), r = int32(color >> 16 & 0xFF);
+					planes[0]         = uint8((( 66 * r + 129 * g +  25 * b + 128) >> 8) +  16);
+					planes[plane]     = uint8(((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128);
+					planes[plane * 2] = uint8(((112 * r -  94 * g -  18 * b + 128) >> 8) + 128);
+				}
+			return;
+		}
+
+		// AVI chunks hold a frame each, padded to an even size.
+		Output.resize(sizeof Chunk);
+		if (Format == VideoFormat::Mjpeg) {
+			vector<uint8> pixels(size_t(width) * height * 3);
+			for (uint32 y = 0; y < height; y++)
+				for (uint32 x = 0; x < width; x++) {
+					const auto color = pixel(x, y);
+					memcpy(&pixels[(size_t(y) * width + x) * 3], &color, 3);
+				}
+
+			_Jpeg.Encode(pixels.data(), width, height, Output);
+		} else {
+			// Bitmap rows are stored bottom to top, each padded to 4 bytes.
+			const auto stride = (size_t(width) * 3 + 3) / 4 * 4;
+			Output.resize(sizeof Chunk + stride * height);
+			for (uint32 y = height; y--;) {
+				auto* row = Output.data() + sizeof Chunk + stride * (height - 1 - y);
+				for (uint32 x = 0; x < width; x++, row += 3) {
+					const auto color = pixel(x, y);
+					memcpy(row, &color, 3);
+				}
+			}
+		}
+
+		const Chunk chunk{FourCC(Format == VideoFormat::Mjpeg ? "00dc" : "00db"), uint32(Output.size() - sizeof chunk)};
+		memcpy(Output.data(), &chunk, sizeof chunk);
+		if (Output.size() & 1)
+			Output.push_back(0);
+	}
+
+	// Append an encoded frame to the file, adding it to the index.
+	// Returns true on error.
+	bool Append(const vector<uint8>& Frame) {
+		if (Format != VideoFormat::Y4m) {
+			// Sizes of RIFF files are 32bit, so frames beyond 4GB, with the index, are dropped.
+			if (sizeof(AVIHeaders) + _Bytes + Frame.size() + sizeof(Chunk) + sizeof(IndexEntry) * (_Index.size() + 1) > ~0u)
+				return true;
+
+			Chunk chunk;
+			memcpy(&chunk, Frame.data(), sizeof chunk);
+
+			// Index offsets are from the type of the list of frames.
+			const auto offset = uint32(sizeof(List) - offsetof(List, Type) + _Bytes);
+			_Index.push_back({chunk.Id, KeyFrame, offset, chunk.Size});
+			_Largest = max(_Largest, chunk.Size);
+		}
+
+		_File.write((const char*)Frame.data(), streamsize(Frame.size()));
+		_Bytes += Frame.size();
+		return _File.fail();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+
+// Wavefront Photon Tracer ================================
+// An alternative to tracing one photon at a time. A batch
+// of photons is emitted into structure-of-arrays buffers,
+// then each bounce proceeds in stages across the batch:
+// every shape intersects the whole batch, survivors are
+// sorted by the material of the shape they hit, then by the
+// shape, and their interactions are shaded in coherent runs:
+// interactions with one material run together, and within
+// them each shape's run dispatches to code of its own.
+// Photons that continue are compacted into the next batch.
+
+
+// A Batch of Photons (Structure of Arrays)
+// Capacity must be a multiple of the widest SIMD lanes.
+// Samplers with per-photon state travel with their photons.
+template <typename ColorType, typename SamplerType, uint32 Capacity>
+struct PhotonBatch {
+	static_assert(Capacity % 16 == 0);
+
+	using RealArray = array<Real, Capacity>;
+
+	alignas(CacheLine) RealArray PosX, PosY, PosZ;		// Photon positions.
+	alignas(CacheLine) RealArray DirX, DirY, DirZ;		// Photon directions.
+	alignas(CacheLine) RealArray HitDist;				// Distance to the nearest intersection.
+	alignas(CacheLine) array<uint32, Capacity> HitShape;	// Scene index of the nearest shape.
+	alignas(CacheLine) array<uint32, Capacity> HitPrim;	// Primitive within the nearest shape.
+	alignas(CacheLine) array<ColorType, Capacity> Color;	// Photon colors.
+	alignas(CacheLine) array<bool, Capacity> Diffuse;		// Was the last interaction connected to the lens?
+	alignas(CacheLine) array<SamplerType, Capacity> Sampler;	// Photon samplers.
+
+	uint32	Count = 0;									// Photons in the batch.
+
+	// Append the state's photon to the batch.
+	template <typename StateType>
+	inline void Store(const StateType& State) {
+		assert(Count < Capacity);
+		PosX [Count] = State.Position.x;
+		PosY [Count] = State.Position.y;
+		PosZ [Count] = State.Position.z;
+		DirX [Count] = State.Direction.x;
+		DirY [Count] = State.Direction.y;
+		DirZ [Count] = State.Direction.z;
+		Color  [Count] = State.Color;
+		Diffuse[Count] = State._Diffuse;
+		if constexpr (!is_empty_v<SamplerType>)
+			Sampler[Count] = State.Sampler;
+		Count++;
+	}
+
+	// Load a photon from the batch into the state.
+	template <typename StateType>
+	inline void Load(const uint32 Index, StateType& State) const {
+		State.Position	= {PosX[Index], PosY[Index], PosZ[Index]};
+		State.Direction	= {DirX[Index], DirY[Index], DirZ[Index]};
+		State.Color		= Color[Index];
+		State._Diffuse	= Diffuse[Index];
+		State._HitDist	= HitDist[Index];
+		State._HitPrim	= HitPrim[Index];
+		if constexpr (!is_empty_v<SamplerType>)
+			State.Sampler = Sampler[Index];
+	}
+};
+
+template <typename ColorType, typename SamplerType = PseudoSampler, uint32 Capacity = 1024>
+struct WavefrontTracer {
+	using BatchType = PhotonBatch<ColorType, SamplerType, Capacity>;
+
+	BatchType	_Batches[2];				// Current and next bounce.
+	array<uint32, Capacity> _Order;			// Photon indices sorted by material, then shape.
+
+	// Emit and trace a chunk of photons from the light in batches.
+	// Photons bounce at most Bounces times, unless absorbed sooner.
+	template <typename SceneType, typename LightType, typename StateType>
+	void Trace(const SceneType& Scene, const LightType& Light, const PhotonChunk& Chunk,
+		const uint32 Bounces, StateType& State) {
+		constexpr auto Shapes = uint32(tuple_size_v<SceneType>);
+		constexpr auto& Rank  = MaterialRank<SceneType>;
+
+		for (auto photon = Chunk.Begin; photon < Chunk.End; ) {
+			auto* batch = &_Batches[0];
+			auto* next  = &_Batches[1];
+
+			// Emit a batch of photons.
+			batch->Count = 0;
+			for (; photon < Chunk.End && batch->Count < Capacity; photon++) {
+				State.Start(photon, Chunk.Light);
+				Light.Emit(State);
+				batch->Store(State);
+			}
+
+			uint32 bounce = 0;
+			for (; bounce < Bounces && batch->Count; bounce++) {
+				// Reset the nearest intersections.
+				fill_n(batch->HitDist .begin(), batch->Count, Infinity);
+				fill_n(batch->HitShape.begin(), batch->Count, NoShape);
+
+				// Intersect the whole batch with each shape in turn.
+				ForEachShape(Scene, [=](const auto& Shape, const uint32 Index) {
+					Shape.HitBatch(*batch, Index);
+				});
+
+				// Sort the photons that hit something by the rank of their
+				// shape, grouping them by material and then by shape (counting sort).
+				array<uint32, Shapes + 1> offsets{};
+				for (uint32 i = 0; i < batch->Count; i++)
+					if (batch->HitShape[i] != NoShape)
+						offsets[Rank[batch->HitShape[i]] + 1]++;
+
+				for (uint32 rank = 0; rank < Shapes; rank++)
+					offsets[rank + 1] += offsets[rank];
+
+				const auto hits = offsets[Shapes];
+				for (uint32 i = 0; i < batch->Count; i++)
+					if (batch->HitShape[i] != NoShape)
+						_Order[offsets[Rank[batch->HitShape[i]]]++] = i;
+
+				// Shade each interaction, compacting survivors into the next batch.
+				next->Count = 0;
+				for (uint32 hit = 0; hit < hits; hit++) {
+					const auto i = _Order[hit];
+					batch->Load(i, State);
+
+					const auto alive = Interact(Scene, batch->HitShape[i], State);
+					ConnectLens(Scene, State);
+
+					if (alive) {
+						next->Store(State);
+						State._Hits++;
+					}
+				}
+
+				// Photons that did not continue terminated at this depth.
+				State.Terminate(bounce, batch->Count - next->Count);
+				swap(batch, next);
+			}
+
+			// Photons still in flight reached the bounce limit.
+			State.Terminate(bounce, batch->Count);
+		}
+	}
+};
\ No newline at end of file
@@ -77,4 +77,118 @@ protected:
 
 
 // Prefer the 128bit RNG.
-using Random = Random128;
\ No newline at end of file
+using Random = Random128;
+
+
+// Multi-Stream Generator =================================
+// Advances several independent Random128 streams at once:
+// four per AVX2 register, with a scalar fallback producing
+// identical values. Streams are spaced 2^96 values apart by
+// LongJump(), and values are interleaved across the streams.
+// Intended to refill pools of random numbers in bulk.
+
+
+struct RandomStreams {
+	static constexpr uint32 Streams = 8;	// Independent streams (two AVX2 registers).
+
+	alignas(CacheLine) array<uint64, Streams> _S0;	// First state word of each stream.
+	alignas(CacheLine) array<uint64, Streams> _S1;	// Second state word of each stream.
+
+	// Seed each stream from the generator, LongJump()ing between streams.
+	RandomStreams(Random128 Seed = {}) {
+		for (uint32 stream = 0; stream < Streams; stream++, Seed.LongJump())
+			this->Seed(stream, Seed);
+	}
+
+	// Set the state of a stream.
+	inline void Seed(const uint32 Stream, const Random128& Generator) {
+		_S0[Stream] = Generator.State[0];
+		_S1[Stream] = Generator.State[1];
+	}
+
+	// Return the state of a stream, as a generator continuing it.
+	[[nodiscard]] inline Random128 Stream(const uint32 Stream) const {
+		Random128 generator;
+		generator.State = {_S0[Stream], _S1[Stream]};
+		return generator;
+	}
+
+	// Fill the target with random values, in AVX2 registers when Wide.
+	// Count must be a multiple of the number of streams.
+	void Fill(uint64* Target, const size_t Count, const bool Wide = CPU.AVX2) {
+		assert(Count % Streams == 0);
+		if (Wide)
+			Generate(Count / Streams, [Target](const size_t Round, const __m256i A, const __m256i B) {
+				_mm256_storeu_si256((__m256i*)&Target[Round * Streams    ], A);
+				_mm256_storeu_si256((__m256i*)&Target[Round * Streams + 4], B);
+			});
+		else
+			for (size_t value = 0; value < Count; value++)
+				Target[value] = Next(value % Streams);
+	}
+
+	// Fill the target with random Reals in the range [0..1), as above.
+	// Each value provides two Reals, with 24 bits of randomness each.
+	// Count must be a multiple of twice the number of streams.
+	void Fill(Real* Target, const size_t Count, const bool Wide = CPU.AVX2) {
+		assert(Count % (Streams * 2) == 0);
+		if (Wide)
+			Generate(Count / (Streams * 2), [Target](const size_t Round, const __m256i A, const __m256i B) {
+				const auto scale = _mm256_set1_ps(0x1p-24r);
+				_mm256_storeu_ps(&Target[Round * Streams * 2    ], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(A, 8)), scale));
+				_mm256_storeu_ps(&Target[Round * Streams * 2 + 8], _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(B, 8)), scale));
+			});
+		else
+			for (size_t value = 0; value < Count; value += 2) {
+				const auto bits = Next((value / 2) % Streams);
+				Target[value    ] = Real(uint32(bits      ) >> 8) * 0x1p-24r;
+				Target[value + 1] = Real(uint32(bits >> 32) >> 8) * 0x1p-24r;
+			}
+	}
+
+protected:
+	// Return the next value of a single stream.
+	inline uint64 Next(const uint32 Stream) {
+		const uint64 s0 = _S0[Stream];
+		      uint64 s1 = _S1[Stream];
+		const uint64 v  = s0 + s1;
+
+		s1 ^= s0;
+		_S0[Stream] = rotl(s0, 24) ^ s1 ^ (s1 << 16);
+		_S1[Stream] = rotl(s1, 37);
+
+		return v;
+	}
+
+	// Advance the streams of a register.
+	static inline void Advance(__m256i& S0, __m256i& S1) {
+		const auto rotl = [](const __m256i X, const int K) {
+			return _mm256_or_si256(_mm256_slli_epi64(X, K), _mm256_srli_epi64(X, 64 - K));
+		};
+
+		S1 = _mm256_xor_si256(S1, S0);
+		S0 = _mm256_xor_si256(_mm256_xor_si256(rotl(S0, 24), S1), _mm256_slli_epi64(S1, 16));
+		S1 = rotl(S1, 37);
+	}
+
+	// Advance every stream the supplied number of rounds, passing
+	// each round's values to the store function, in two registers.
+	template <typename StoreFunc>
+	inline void Generate(const size_t Rounds, const StoreFunc& Store) {
+		auto a0 = _mm256_load_si256((const __m256i*)&_S0[0]);
+		auto a1 = _mm256_load_si256((const __m256i*)&_S1[0]);
+		auto b0 = _mm256_load_si256((const __m256i*)&_S0[4]);
+		auto b1 = _mm256_load_si256((const __m256i*)&_S1[4]);
+
+		for (size_t round = 0; round < Rounds; round++) {
+			Store(round, _mm256_add_epi64(a0, a1), _mm256_add_epi64(b0, b1));
+			Advance(a0, a1);
+			Advance(b0, b1);
+		}
+
+		_mm256_store_si256((__m256i*)&_S0[0], a0);
+		_mm256_store_si256((__m256i*)&_S1[0], a1);
+		_mm256_store_si256((__m256i*)&_S0[4], b0);
+		_mm256_store_si256((__m256i*)&_S1[4], b1);
+	}
+};
\ No newline at end of file